@@ -0,0 +1,488 @@
+#pragma once
+
+/**
+ * Minimal benchmark harness shared by the bench.<name> targets
+ *
+ *   int main(int argc, char **argv)
+ *   {
+ *       ut::bench::runner r(argc, argv);
+ *       r.run("split", [&]() { ut::bench::do_not_optimize(ut::str::split(line, ',')); });
+ *       return r.finish();
+ *   }
+ *
+ * Options:
+ *   --filter <text>      only run benchmarks whose name contains text
+ *   --reps <n>           timed samples per benchmark (default 15)
+ *   --sample-ms <ms>     target duration of one sample (default 10)
+ *   --perf               read hardware counters through perf_event_open (linux), summed over the process's
+ *                        threads started after the runner (benchmark threads, job_system::global() workers)
+ *   --json <file>        write the results as json
+ *   --baseline <file>    compare the medians against a json written by --json
+ *   --threshold <pct>    slowdown reported as regression (default 5), exit code 1 if any
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__linux__)
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+
+namespace ut
+{
+namespace bench
+{
+
+// keep `value` alive as if it was read by something the compiler can't see
+template <typename T>
+inline void do_not_optimize(T const &value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    volatile char sink = *reinterpret_cast<const volatile char *>(&value);
+    (void)sink;
+    _ReadWriteBarrier();
+#endif
+}
+
+// force pending writes to memory, they can't be optimized away or moved across this point
+inline void clobber_memory()
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : : "memory");
+#else
+    _ReadWriteBarrier();
+#endif
+}
+
+
+struct result
+{
+    std::string name;
+    uint64_t    iterations = 0; // per sample
+    double      median_ns  = 0; // all *_ns are per operation
+    double      mean_ns    = 0;
+    double      stddev_ns  = 0;
+    double      min_ns     = 0;
+    double      max_ns     = 0;
+    double      bytes      = 0; // processed per operation, 0 = no throughput
+
+    // per operation, negative when not available; the calling thread plus the threads started after the runner
+    double cycles        = -1;
+    double instructions  = -1;
+    double cache_misses  = -1;
+    double branch_misses = -1;
+
+    double mb_per_s() const { return bytes > 0 && median_ns > 0 ? bytes / median_ns * 1e3 : 0; }
+};
+
+
+#if defined(__linux__)
+class perf_counters
+{
+    static constexpr int N   = 4;
+    int                  _fd[N] = {-1, -1, -1, -1};
+
+  public:
+    bool open()
+    {
+        static constexpr uint64_t configs[N] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        bool bAny = false;
+        for (int i = 0; i < N; ++i) {
+            perf_event_attr attr{};
+            attr.type           = PERF_TYPE_HARDWARE;
+            attr.size           = sizeof(attr);
+            attr.config         = configs[i];
+            attr.disabled       = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv     = 1;
+            attr.inherit        = 1; // threads created from here on count too, multi threaded benchmarks aren't just a join()
+            _fd[i]              = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            bAny |= _fd[i] >= 0;
+        }
+        return bAny;
+    }
+
+    ~perf_counters()
+    {
+        for (int fd : _fd) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    void start()
+    {
+        for (int fd : _fd) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+    }
+
+    // -1 for counters that couldn't be opened
+    void stop(double (&out)[N])
+    {
+        for (int i = 0; i < N; ++i) {
+            out[i] = -1;
+            if (_fd[i] >= 0) {
+                ioctl(_fd[i], PERF_EVENT_IOC_DISABLE, 0);
+                uint64_t v = 0;
+                if (read(_fd[i], &v, sizeof(v)) == sizeof(v)) {
+                    out[i] = static_cast<double>(v);
+                }
+            }
+        }
+    }
+};
+#else
+class perf_counters
+{
+  public:
+    bool open() { return false; }
+    void start() {}
+    void stop(double (&out)[4])
+    {
+        for (double &v : out) {
+            v = -1;
+        }
+    }
+};
+#endif
+
+
+class runner
+{
+    std::string _filter;
+    std::string _json_path;
+    std::string _baseline_path;
+    int         _reps      = 15;
+    double      _sample_ms = 10;
+    double      _threshold = 5;
+    bool        _bPerf     = false;
+
+    perf_counters       _perf;
+    std::vector<result> _results;
+
+  public:
+    runner(int argc, char **argv)
+    {
+        for (int i = 1; i < argc; ++i) {
+            std::string_view arg  = argv[i];
+            const char      *next = i + 1 < argc ? argv[i + 1] : "";
+            if (arg == "--filter") {
+                _filter = next, ++i;
+            }
+            else if (arg == "--reps") {
+                _reps = std::max(1, std::atoi(next)), ++i;
+            }
+            else if (arg == "--sample-ms") {
+                _sample_ms = std::max(0.1, std::atof(next)), ++i;
+            }
+            else if (arg == "--json") {
+                _json_path = next, ++i;
+            }
+            else if (arg == "--baseline") {
+                _baseline_path = next, ++i;
+            }
+            else if (arg == "--threshold") {
+                _threshold = std::atof(next), ++i;
+            }
+            else if (arg == "--perf") {
+                _bPerf = true;
+            }
+        }
+
+        if (_bPerf && !_perf.open()) {
+            std::fprintf(stderr, "perf_event_open not available, running without hardware counters\n");
+            _bPerf = false;
+        }
+
+        std::printf("%-40s %12s %12s %8s %12s %10s", "benchmark", "median", "min", "stddev", "iterations", "MB/s");
+        if (_bPerf) {
+            std::printf(" %10s %8s %10s %10s", "cycles", "IPC", "cache-miss", "br-miss");
+        }
+        std::printf("\n");
+    }
+
+    /**
+     * Time fn(), which performs one operation.
+     * @param bytes processed by one operation, reported as MB/s when not 0
+     * @return nullopt when skipped by --filter
+     */
+    template <typename Fn>
+    std::optional<result> run(std::string_view name, Fn &&fn, double bytes = 0)
+    {
+        if (!_filter.empty() && name.find(_filter) == std::string_view::npos) {
+            return std::nullopt;
+        }
+
+        using clock = std::chrono::steady_clock;
+        auto time_n = [&fn](uint64_t n) {
+            auto t0 = clock::now();
+            for (uint64_t i = 0; i < n; ++i) {
+                fn();
+                clobber_memory();
+            }
+            return std::chrono::duration<double, std::nano>(clock::now() - t0).count();
+        };
+
+        // warmup + calibration: grow the batch until one sample takes about _sample_ms
+        const double target = _sample_ms * 1e6;
+        uint64_t     n      = 1;
+        while (true) {
+            double ns = time_n(n);
+            if (ns >= target || n >= (uint64_t(1) << 40)) {
+                break;
+            }
+            double scale = ns > 0 ? target / ns : 100;
+            n            = std::max(n + 1, static_cast<uint64_t>(n * std::min(scale * 1.2, 100.0)));
+        }
+
+        std::vector<double> samples;
+        double              counters_sum[4] = {0, 0, 0, 0};
+        for (int r = 0; r < _reps; ++r) {
+            double counters[4];
+            if (_bPerf) {
+                _perf.start();
+            }
+            samples.push_back(time_n(n) / static_cast<double>(n));
+            if (_bPerf) {
+                _perf.stop(counters);
+                for (int i = 0; i < 4; ++i) {
+                    counters_sum[i] = counters[i] < 0 || counters_sum[i] < 0 ? -1 : counters_sum[i] + counters[i];
+                }
+            }
+        }
+
+        result res;
+        res.name       = name;
+        res.iterations = n;
+        res.bytes      = bytes;
+
+        std::sort(samples.begin(), samples.end());
+        const size_t m = samples.size();
+        res.median_ns  = m % 2 ? samples[m / 2] : (samples[m / 2 - 1] + samples[m / 2]) / 2;
+        res.min_ns     = samples.front();
+        res.max_ns     = samples.back();
+        for (double s : samples) {
+            res.mean_ns += s / m;
+        }
+        for (double s : samples) {
+            res.stddev_ns += (s - res.mean_ns) * (s - res.mean_ns) / m;
+        }
+        res.stddev_ns = std::sqrt(res.stddev_ns);
+
+        if (_bPerf) {
+            const double ops = static_cast<double>(n) * _reps;
+            double *out[4]   = {&res.cycles, &res.instructions, &res.cache_misses, &res.branch_misses};
+            for (int i = 0; i < 4; ++i) {
+                *out[i] = counters_sum[i] < 0 ? -1 : counters_sum[i] / ops;
+            }
+        }
+
+        print(res);
+        _results.push_back(res);
+        return res;
+    }
+
+    const std::vector<result> &results() const { return _results; }
+
+    /**
+     * Write json / compare against the baseline
+     * @return process exit code, 1 when a benchmark regressed beyond the threshold
+     */
+    int finish()
+    {
+        if (!_json_path.empty()) {
+            write_json(_json_path);
+        }
+        if (!_baseline_path.empty()) {
+            return compare(_baseline_path) ? 0 : 1;
+        }
+        return 0;
+    }
+
+  private:
+    static std::string format_ns(double ns)
+    {
+        char buf[32];
+        if (ns < 1e3) {
+            std::snprintf(buf, sizeof(buf), "%.2f ns", ns);
+        }
+        else if (ns < 1e6) {
+            std::snprintf(buf, sizeof(buf), "%.2f us", ns / 1e3);
+        }
+        else {
+            std::snprintf(buf, sizeof(buf), "%.2f ms", ns / 1e6);
+        }
+        return buf;
+    }
+
+    void print(const result &r) const
+    {
+        std::printf("%-40s %12s %12s %7.1f%% %12llu", r.name.c_str(), format_ns(r.median_ns).c_str(), format_ns(r.min_ns).c_str(),
+                    r.median_ns > 0 ? r.stddev_ns / r.median_ns * 100 : 0.0, static_cast<unsigned long long>(r.iterations));
+        if (r.bytes > 0) {
+            std::printf(" %10.1f", r.mb_per_s());
+        }
+        else {
+            std::printf(" %10s", "-");
+        }
+        if (_bPerf) {
+            std::printf(" %10.1f %8.2f %10.2f %10.2f", r.cycles, r.cycles > 0 ? r.instructions / r.cycles : 0.0, r.cache_misses, r.branch_misses);
+        }
+        std::printf("\n");
+        std::fflush(stdout);
+    }
+
+    // a json string body: quote, backslash and control characters escaped, everything else (utf-8 too) as is
+    static std::string json_escape(std::string_view text)
+    {
+        std::string ret;
+        ret.reserve(text.size());
+        for (char c : text) {
+            switch (c) {
+            case '"': ret += "\\\""; break;
+            case '\\': ret += "\\\\"; break;
+            case '\n': ret += "\\n"; break;
+            case '\r': ret += "\\r"; break;
+            case '\t': ret += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(c));
+                    ret += buf;
+                }
+                else {
+                    ret += c;
+                }
+            }
+        }
+        return ret;
+    }
+
+    // the string starting at `pos` up to its closing quote, unescaped; reads back what json_escape writes
+    static std::string json_unescape(std::string_view line, size_t pos)
+    {
+        std::string ret;
+        for (; pos < line.size() && line[pos] != '"'; ++pos) {
+            if (line[pos] != '\\' || pos + 1 == line.size()) {
+                ret += line[pos];
+                continue;
+            }
+            switch (const char c = line[++pos]) {
+            case 'n': ret += '\n'; break;
+            case 'r': ret += '\r'; break;
+            case 't': ret += '\t'; break;
+            case 'u':
+                ret += static_cast<char>(std::strtoul(std::string(line.substr(pos + 1, 4)).c_str(), nullptr, 16));
+                pos += 4;
+                break;
+            default: ret += c; // quote and backslash
+            }
+        }
+        return ret;
+    }
+
+    // one benchmark per line, so files diff nicely and the baseline reader stays trivial
+    void write_json(const std::string &path) const
+    {
+        std::ofstream f(path);
+        f << "{\"benchmarks\": [\n";
+        for (size_t i = 0; i < _results.size(); ++i) {
+            const result &r = _results[i];
+            f << "  {\"name\": \"" << json_escape(r.name) << "\""
+              << ", \"iterations\": " << r.iterations
+              << ", \"median_ns\": " << r.median_ns
+              << ", \"mean_ns\": " << r.mean_ns
+              << ", \"stddev_ns\": " << r.stddev_ns
+              << ", \"min_ns\": " << r.min_ns
+              << ", \"max_ns\": " << r.max_ns;
+            if (r.bytes > 0) {
+                f << ", \"mb_per_s\": " << r.mb_per_s();
+            }
+            if (r.cycles >= 0) {
+                f << ", \"cycles\": " << r.cycles;
+            }
+            if (r.instructions >= 0) {
+                f << ", \"instructions\": " << r.instructions;
+            }
+            if (r.cache_misses >= 0) {
+                f << ", \"cache_misses\": " << r.cache_misses;
+            }
+            if (r.branch_misses >= 0) {
+                f << ", \"branch_misses\": " << r.branch_misses;
+            }
+            f << "}" << (i + 1 < _results.size() ? "," : "") << "\n";
+        }
+        f << "]}\n";
+    }
+
+    static std::map<std::string, double> read_baseline(const std::string &path)
+    {
+        std::map<std::string, double> ret;
+        std::ifstream                 f(path);
+        std::string                   line;
+        while (std::getline(f, line)) {
+            auto name_pos   = line.find("\"name\": \"");
+            auto median_pos = line.find("\"median_ns\": ");
+            if (name_pos == std::string::npos || median_pos == std::string::npos) {
+                continue;
+            }
+            ret[json_unescape(line, name_pos + 9)] = std::atof(line.c_str() + median_pos + 13);
+        }
+        return ret;
+    }
+
+    bool compare(const std::string &path) const
+    {
+        auto baseline = read_baseline(path);
+        if (baseline.empty()) {
+            std::fprintf(stderr, "no baseline results in %s\n", path.c_str());
+            return true;
+        }
+
+        bool bOk = true;
+        std::printf("\n%-40s %12s %12s %9s\n", "vs baseline", "baseline", "now", "change");
+        for (const result &r : _results) {
+            auto it = baseline.find(r.name);
+            if (it == baseline.end() || it->second <= 0) {
+                continue;
+            }
+            double change = (r.median_ns - it->second) / it->second * 100;
+            bool   bSlow  = change > _threshold;
+            bOk &= !bSlow;
+            std::printf("%-40s %12s %12s %+8.1f%%%s\n", r.name.c_str(), format_ns(it->second).c_str(), format_ns(r.median_ns).c_str(),
+                        change, bSlow ? "  REGRESSION" : "");
+        }
+        return bOk;
+    }
+};
+
+} // namespace bench
+} // namespace ut
@@ -0,0 +1,50 @@
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "bench.h"
+#include "utility.cc/blob_store.h"
+
+using ut::bench::do_not_optimize;
+
+// New writes against repeated writes of the same bytes, which should cost a lookup (+ compare)
+
+int main(int argc, char **argv)
+{
+    ut::bench::runner r(argc, argv);
+
+    auto root = std::filesystem::temp_directory_path() / "utility_cc_bench_blobs";
+    std::filesystem::remove_all(root);
+
+    std::string artifact(1024 * 1024, 'x');
+    for (size_t i = 0; i < artifact.size(); i += 61) {
+        artifact[i] = static_cast<char>(i);
+    }
+    auto src = root.parent_path() / "utility_cc_bench_artifact.bin";
+    std::ofstream(src, std::ios::binary) << artifact;
+
+    ut::blob_store store(root);
+    ut::blob_store trusting(root, {.bVerifyOnHit = false});
+
+    std::string fresh = artifact;
+    uint64_t    n     = 0;
+    r.run("put/1m/new", [&]() {
+        ++n;
+        std::memcpy(fresh.data(), &n, sizeof(n));
+        do_not_optimize(store.put(fresh));
+    }, artifact.size());
+
+    store.put(artifact);
+    r.run("put/1m/duplicate", [&]() { do_not_optimize(store.put(artifact)); }, artifact.size());
+    r.run("put/1m/duplicate/no_verify", [&]() { do_not_optimize(trusting.put(artifact)); }, artifact.size());
+    r.run("put_file/1m/duplicate", [&]() { do_not_optimize(store.put_file(src)); }, artifact.size());
+
+    auto digest = *store.put(artifact);
+    r.run("contains", [&]() { do_not_optimize(store.contains(digest)); });
+
+    std::filesystem::remove(src);
+    std::filesystem::remove_all(root);
+    return r.finish();
+}
@@ -0,0 +1,74 @@
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "bench.h"
+#include "utility.cc/csv.h"
+#include "utility.cc/parallel.h"
+#include "utility.cc/string_utils.h"
+
+using ut::bench::do_not_optimize;
+
+// Tokenizer throughput against split() per line, from memory, from a file and split across threads
+
+static size_t count_fields(ut::csv::reader &r)
+{
+    size_t       n = 0;
+    ut::csv::row fields;
+    while (r.next(fields)) {
+        n += fields.size();
+    }
+    return n;
+}
+
+int main(int argc, char **argv)
+{
+    ut::bench::runner r(argc, argv);
+
+    std::string plain, quoted;
+    for (int i = 0; i < 200000; ++i) {
+        std::string id = std::to_string(i);
+        plain += id + ",2024-01-01,INFO,server," + id + ",ok,0.5,done\n";
+        quoted += id + ",\"Doe, John\",\"said \"\"hi\"\"\",\"multi\nline\",ok\n";
+    }
+
+    r.run("reader/plain", [&]() {
+        ut::csv::reader rd(plain);
+        do_not_optimize(count_fields(rd));
+    }, plain.size());
+
+    r.run("reader/plain/split_lines", [&]() {
+        size_t n = 0;
+        for (auto &line : ut::str::split(plain, '\n')) {
+            n += ut::str::split(line, ',').size();
+        }
+        do_not_optimize(n);
+    }, plain.size());
+
+    r.run("reader/quoted", [&]() {
+        ut::csv::reader rd(quoted);
+        do_not_optimize(count_fields(rd));
+    }, quoted.size());
+
+    auto path = std::filesystem::temp_directory_path() / "utility_cc_bench.csv";
+    std::ofstream(path, std::ios::binary) << plain;
+    r.run("reader/plain/file", [&]() {
+        auto rd = ut::csv::reader::open(path);
+        do_not_optimize(count_fields(*rd));
+    }, plain.size());
+
+    const unsigned threads = ut::job_system::global().concurrency();
+    r.run("reader/plain/split_records/threads:" + std::to_string(threads), [&]() {
+        auto                slices = ut::csv::split_records(plain, threads * 4);
+        std::atomic<size_t> n      = 0;
+        ut::parallel_for(0, slices.size(), [&](size_t i) {
+            ut::csv::reader rd(slices[i]);
+            n += count_fields(rd);
+        }, {.grain = 1});
+        do_not_optimize(n.load());
+    }, plain.size());
+
+    std::filesystem::remove(path);
+    return r.finish();
+}
@@ -0,0 +1,89 @@
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "bench.h"
+#include "utility.cc/file_utils.h"
+#include "utility.cc/string_utils.h"
+#include "utility.cc/tree_hash.h"
+
+using ut::bench::do_not_optimize;
+
+
+static std::filesystem::path write_file(const std::string &name, const std::string &content)
+{
+    auto path = std::filesystem::temp_directory_path() / name;
+    std::ofstream(path, std::ios::binary).write(content.data(), static_cast<std::streamsize>(content.size()));
+    return path;
+}
+
+int main(int argc, char **argv)
+{
+    ut::bench::runner r(argc, argv);
+
+    std::string small(4 * 1024, 'a');
+    std::string large(16 * 1024 * 1024, 'b');
+    for (size_t i = 0; i < large.size(); i += 97) {
+        large[i] = static_cast<char>(i);
+    }
+    std::string png = std::string("\x89PNG\r\n\x1a\n", 8) + std::string(1024, '\0');
+
+    auto small_path = write_file("utility_cc_bench_small.bin", small);
+    auto large_path = write_file("utility_cc_bench_large.bin", large);
+    auto png_path   = write_file("utility_cc_bench_image.png", png);
+
+    r.run("read_all/4k", [&]() { do_not_optimize(ut::file::read_all(small_path)); }, small.size());
+    r.run("read_all/16m", [&]() { do_not_optimize(ut::file::read_all(large_path)); }, large.size());
+
+    r.run("read_cached/4k", [&]() { do_not_optimize(ut::file::read_cached(small_path)); }, small.size());
+    r.run("read_cached/16m", [&]() { do_not_optimize(ut::file::read_cached(large_path)); }, large.size());
+
+    r.run("ImageInfo::detect/png", [&]() { do_not_optimize(ut::file::ImageInfo::detect(png_path)); });
+
+    r.run("get_content_hash/4k", [&]() { do_not_optimize(ut::file::get_content_hash(small_path)); }, small.size());
+    r.run("get_content_hash/16m", [&]() { do_not_optimize(ut::file::get_content_hash(large_path)); }, large.size());
+
+    r.run("tree_hash::of_file/16m", [&]() { do_not_optimize(ut::file::tree_hash::of_file(large_path)->root()); }, large.size());
+    r.run("tree_hash::of_file/16m/1_thread", [&]() {
+        ut::file::tree_hash::options opt;
+        opt.parallel.max_threads = 1;
+        do_not_optimize(ut::file::tree_hash::of_file(large_path, opt)->root());
+    }, large.size());
+
+    r.run("get_hash/4k", [&]() { do_not_optimize(ut::file::get_hash(small)); }, small.size());
+    r.run("get_hash/16m", [&]() { do_not_optimize(ut::file::get_hash(large)); }, large.size());
+
+    // 64 MB log; real ones are often past read_all's 128 MB limit
+    std::string log;
+    for (size_t i = 0; log.size() < 64 * 1024 * 1024; ++i) {
+        log += "2024-01-01T00:00:00 INFO request " + std::to_string(i) + " served in " + std::to_string(i % 997) + "us\n";
+    }
+    auto log_path = write_file("utility_cc_bench.log", log);
+
+    r.run("mapped_file::open/64m", [&]() { do_not_optimize(ut::file::mapped_file::open(log_path)->size()); });
+    r.run("line_index::build/64m", [&]() { do_not_optimize(ut::file::line_index::build(log_path)->lines()); }, log.size());
+    r.run("line_index::build/64m/read_all_split", [&]() {
+        do_not_optimize(ut::str::split(*ut::file::read_all(log_path), '\n').size());
+    }, log.size());
+
+    auto   index  = ut::file::line_index::build(log_path);
+    auto   mapped = ut::file::mapped_file::open(log_path);
+    size_t n      = 0;
+    r.run("line_index::line/random", [&]() {
+        n = (n * 2654435761u + 1) % index->lines();
+        do_not_optimize(index->line(mapped->view(), n));
+    });
+
+    std::string tail = "2024-01-02T00:00:00 INFO appended line\n";
+    r.run("line_index::update/append_1_line", [&]() {
+        std::ofstream(log_path, std::ios::binary | std::ios::app) << tail;
+        do_not_optimize(index->update_file(log_path));
+    }, tail.size());
+
+    std::filesystem::remove(small_path);
+    std::filesystem::remove(large_path);
+    std::filesystem::remove(png_path);
+    std::filesystem::remove(log_path);
+
+    return r.finish();
+}
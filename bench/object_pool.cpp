@@ -0,0 +1,49 @@
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "utility.cc/object_pool.h"
+
+using ut::bench::do_not_optimize;
+
+
+struct Payload
+{
+    std::string name = "payload";
+    char        data[240];
+};
+
+int main(int argc, char **argv)
+{
+    ut::bench::runner r(argc, argv);
+
+    // steady state: objects come from the free queue
+    ObjectPool<Payload> pool;
+    pool.returnBack(pool.acquire());
+    r.run("acquire_returnBack/reuse", [&]() {
+        Payload *p = pool.acquire();
+        do_not_optimize(p);
+        pool.returnBack(p);
+    });
+
+    r.run("acquire_returnBack/batch_of_5", [&]() {
+        Payload *items[5];
+        for (auto &p : items) {
+            p = pool.acquire();
+        }
+        do_not_optimize(items);
+        for (auto *p : items) {
+            pool.returnBack(p);
+        }
+    });
+
+    // cold: a fresh pool allocates every object it hands out, up to maxSize
+    r.run("acquire/fill_fresh_pool_20", [&]() {
+        ObjectPool<Payload> fresh;
+        for (size_t i = 0; i < fresh.maxSize; ++i) {
+            do_not_optimize(fresh.acquire());
+        }
+    });
+
+    return r.finish();
+}
@@ -0,0 +1,54 @@
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "utility.cc/parallel.h"
+
+// Scaling of parallel_transform / parallel_reduce from 1 thread to every worker
+
+int main(int argc, char **argv)
+{
+    ut::bench::runner r(argc, argv);
+
+    constexpr size_t    N = 1 << 22;
+    std::vector<float>  values(N);
+    std::vector<double> out(N);
+    std::iota(values.begin(), values.end(), 0.f);
+
+    const unsigned max_threads = ut::job_system::global().concurrency();
+
+    std::vector<double> transform_ns, reduce_ns;
+    for (unsigned threads = 1; threads <= max_threads; ++threads) {
+        ut::parallel_options opt{.max_threads = threads};
+        std::string          suffix = "/threads:" + std::to_string(threads);
+
+        auto t = r.run(
+            "parallel_transform/enumerate" + suffix, [&]() {
+                ut::parallel_transform(
+                    values | ut::enumerate, out, [](auto &&item) { return std::sqrt(item.value) * double(item.index & 7); }, opt);
+            },
+            N * sizeof(float));
+
+        auto s = r.run(
+            "parallel_reduce/sin" + suffix, [&]() {
+                ut::bench::do_not_optimize(ut::parallel_reduce(
+                    values, 0.0, [](float v) { return double(std::sin(v)); }, [](double a, double b) { return a + b; }, opt));
+            },
+            N * sizeof(float));
+
+        transform_ns.push_back(t ? t->median_ns : 0);
+        reduce_ns.push_back(s ? s->median_ns : 0);
+    }
+
+    std::printf("\n%-8s %18s %18s\n", "threads", "transform speedup", "reduce speedup");
+    for (unsigned i = 0; i < max_threads; ++i) {
+        std::printf("%-8u %17.2fx %17.2fx\n", i + 1,
+                    transform_ns[i] > 0 ? transform_ns[0] / transform_ns[i] : 0.0,
+                    reduce_ns[i] > 0 ? reduce_ns[0] / reduce_ns[i] : 0.0);
+    }
+
+    return r.finish();
+}
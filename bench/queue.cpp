@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "utility.cc/queue.h"
+
+// Throughput (ops/s) and push to pop latency of spsc_queue/mpmc_queue against a mutex guarded deque,
+// from 1 producer/1 consumer up to 4/4
+
+// what the handoffs used before: std::deque behind a mutex, bounded like the others
+template <typename T>
+class locked_queue
+{
+  public:
+    explicit locked_queue(size_t capacity) : _capacity(capacity) {}
+
+    bool try_push(T value)
+    {
+        std::lock_guard lock(_mutex);
+        if (_items.size() == _capacity) {
+            return false;
+        }
+        _items.push_back(std::move(value));
+        return true;
+    }
+    std::optional<T> try_pop()
+    {
+        std::lock_guard lock(_mutex);
+        if (_items.empty()) {
+            return std::nullopt;
+        }
+        std::optional<T> ret = std::move(_items.front());
+        _items.pop_front();
+        return ret;
+    }
+
+  private:
+    std::mutex    _mutex;
+    std::deque<T> _items;
+    size_t        _capacity;
+};
+
+using clock_type = std::chrono::steady_clock;
+
+static uint64_t now_ns()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now().time_since_epoch()).count());
+}
+
+/**
+ * Move `items` timestamps from `producers` to `consumers` threads, batch > 1 uses the batch calls.
+ * With `latencies` every consumer records now - timestamp of what it popped.
+ */
+template <typename Queue>
+void transfer(Queue &q, int producers, int consumers, size_t items, size_t batch, std::vector<uint64_t> *latencies = nullptr)
+{
+    std::atomic<size_t>                popped{0};
+    std::vector<std::vector<uint64_t>> seen(static_cast<size_t>(consumers));
+    std::vector<std::thread>           threads;
+
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p]() {
+            const size_t          count = items / static_cast<size_t>(producers) + (static_cast<size_t>(p) < items % static_cast<size_t>(producers));
+            std::vector<uint64_t> stamps(batch);
+            for (size_t done = 0; done < count;) {
+                size_t n = 0;
+                if constexpr (requires { q.try_push_batch(stamps.begin(), stamps.end()); }) {
+                    const size_t want = std::min(batch, count - done);
+                    std::fill_n(stamps.begin(), want, now_ns());
+                    n = batch > 1 ? q.try_push_batch(stamps.begin(), stamps.begin() + static_cast<std::ptrdiff_t>(want)) : q.try_push(stamps[0]);
+                }
+                else {
+                    n = q.try_push(now_ns());
+                }
+                done += n;
+                if (!n) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (int c = 0; c < consumers; ++c) {
+        threads.emplace_back([&, c]() {
+            std::vector<uint64_t> got;
+            got.reserve(batch);
+            auto &mine = seen[static_cast<size_t>(c)];
+            while (popped.load(std::memory_order_relaxed) < items) {
+                got.clear();
+                if constexpr (requires { q.try_pop_batch(std::back_inserter(got), batch); }) {
+                    q.try_pop_batch(std::back_inserter(got), batch);
+                }
+                else if (auto v = q.try_pop()) {
+                    got.push_back(*v);
+                }
+                if (got.empty()) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                if (latencies) {
+                    const uint64_t t = now_ns();
+                    for (uint64_t stamp : got) {
+                        mine.push_back(t - stamp);
+                    }
+                }
+                popped.fetch_add(got.size(), std::memory_order_relaxed);
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    if (latencies) {
+        for (auto &v : seen) {
+            latencies->insert(latencies->end(), v.begin(), v.end());
+        }
+    }
+}
+
+struct row
+{
+    std::string name;
+    double      ops_per_s = 0;
+    double      p50_ns    = 0;
+    double      p99_ns    = 0;
+    double      p999_ns   = 0;
+};
+
+static double percentile(std::vector<uint64_t> &v, double p)
+{
+    if (v.empty()) {
+        return 0;
+    }
+    auto it = v.begin() + static_cast<std::ptrdiff_t>(p * static_cast<double>(v.size() - 1));
+    std::nth_element(v.begin(), it, v.end());
+    return static_cast<double>(*it);
+}
+
+constexpr size_t items    = 1 << 16;
+constexpr size_t capacity = 1024;
+
+// ops/s from the timed runs, latency percentiles from one more run that records them
+template <typename Queue>
+void measure(ut::bench::runner &r, std::vector<row> &rows, const std::string &name, int producers, int consumers, size_t batch)
+{
+    auto res = r.run(name, [&]() {
+        Queue q(capacity);
+        transfer(q, producers, consumers, items, batch);
+    });
+    if (!res) {
+        return;
+    }
+    Queue                 q(capacity);
+    std::vector<uint64_t> latencies;
+    transfer(q, producers, consumers, items, batch, &latencies);
+    rows.push_back({name, items / res->median_ns * 1e9, percentile(latencies, 0.5), percentile(latencies, 0.99), percentile(latencies, 0.999)});
+}
+
+int main(int argc, char **argv)
+{
+    ut::bench::runner r(argc, argv);
+    std::vector<row>  rows;
+
+    measure<ut::spsc_queue<uint64_t>>(r, rows, "spsc/1p1c", 1, 1, 1);
+    measure<ut::spsc_queue<uint64_t>>(r, rows, "spsc/1p1c/batch32", 1, 1, 32);
+    measure<ut::mpmc_queue<uint64_t>>(r, rows, "mpmc/1p1c", 1, 1, 1);
+    measure<locked_queue<uint64_t>>(r, rows, "mutex/1p1c", 1, 1, 1);
+    for (int n : {2, 4}) {
+        const std::string suffix = "/" + std::to_string(n) + "p" + std::to_string(n) + "c";
+        measure<ut::mpmc_queue<uint64_t>>(r, rows, "mpmc" + suffix, n, n, 1);
+        measure<ut::mpmc_queue<uint64_t>>(r, rows, "mpmc" + suffix + "/batch32", n, n, 32);
+        measure<locked_queue<uint64_t>>(r, rows, "mutex" + suffix, n, n, 1);
+    }
+
+    std::printf("\n%-28s %14s %12s %12s %12s\n", "queue", "ops/s", "p50 ns", "p99 ns", "p99.9 ns");
+    for (const row &x : rows) {
+        std::printf("%-28s %14.0f %12.0f %12.0f %12.0f\n", x.name.c_str(), x.ops_per_s, x.p50_ns, x.p99_ns, x.p999_ns);
+    }
+
+    return r.finish();
+}
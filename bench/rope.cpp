@@ -0,0 +1,62 @@
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "utility.cc/rope.h"
+#include "utility.cc/string_utils.h"
+
+using ut::bench::do_not_optimize;
+
+// Building a generated document piece by piece: a std::string rebuilt per edit against ut::rope
+
+int main(int argc, char **argv)
+{
+    ut::bench::runner r(argc, argv);
+
+    std::vector<std::string> lines;
+    size_t                   bytes = 0;
+    for (int i = 0; i < 4000; ++i) {
+        lines.push_back("    int field_" + std::to_string(i) + " = " + std::to_string(i * 7) + ";\n");
+        bytes += lines.back().size();
+    }
+
+    r.run("append/string_concat", [&]() {
+        std::string out;
+        for (const auto &line : lines) {
+            out = ut::str::concat({out, line});
+        }
+        do_not_optimize(out);
+    }, bytes);
+    r.run("append/rope_borrow", [&]() {
+        ut::rope out;
+        for (const auto &line : lines) {
+            out.borrow(line);
+        }
+        do_not_optimize(out.flatten());
+    }, bytes);
+    r.run("append/rope_copy", [&]() {
+        ut::rope out;
+        for (const auto &line : lines) {
+            out.append(line);
+        }
+        do_not_optimize(out.flatten());
+    }, bytes);
+
+    // every new line goes to the middle, e.g. declarations collected ahead of their definitions
+    r.run("insert_middle/string", [&]() {
+        std::string out;
+        for (const auto &line : lines) {
+            out.insert(out.size() / 2, line);
+        }
+        do_not_optimize(out);
+    }, bytes);
+    r.run("insert_middle/rope", [&]() {
+        ut::rope out;
+        for (const auto &line : lines) {
+            out.insert_borrowed(out.size() / 2, line);
+        }
+        do_not_optimize(out.flatten());
+    }, bytes);
+
+    return r.finish();
+}
@@ -0,0 +1,49 @@
+#include <string>
+
+#include "bench.h"
+#include "utility.cc/stack_deleter.h"
+
+using ut::bench::do_not_optimize;
+
+
+int main(int argc, char **argv)
+{
+    ut::bench::runner r(argc, argv);
+
+    int counter = 0;
+
+    r.run("push_clear/4_custom", [&]() {
+        ut::StackDeleter deleter;
+        for (int i = 0; i < 4; ++i) {
+            deleter.push("cleanup", [&counter](void *) { ++counter; });
+        }
+        deleter.clear();
+    });
+
+    r.run("push_clear/4_handles", [&]() {
+        ut::StackDeleter deleter;
+        for (int i = 0; i < 4; ++i) {
+            deleter.push("int", new int(i), [](void *p) { delete static_cast<int *>(p); });
+        }
+    }); // cleared by the destructor
+
+    r.run("push_clear/64_handles_long_names", [&]() {
+        ut::StackDeleter deleter;
+        for (int i = 0; i < 64; ++i) {
+            deleter.push("a resource name longer than the small string buffer", new int(i), [](void *p) { delete static_cast<int *>(p); });
+        }
+        do_not_optimize(deleter.size());
+    });
+
+    r.run("move/4_items", [&]() {
+        ut::StackDeleter deleter;
+        for (int i = 0; i < 4; ++i) {
+            deleter.push("cleanup", [&counter](void *) { ++counter; });
+        }
+        ut::StackDeleter moved = std::move(deleter);
+        do_not_optimize(moved.empty());
+    });
+
+    do_not_optimize(counter);
+    return r.finish();
+}
@@ -0,0 +1,146 @@
+#include <array>
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bench.h"
+#include "utility.cc/string_utils.h"
+
+using ut::bench::do_not_optimize;
+
+
+int main(int argc, char **argv)
+{
+    ut::bench::runner r(argc, argv);
+
+    const std::string short_line = "key=value";
+    const std::string csv_line   = "1970-01-01,00:00:00,INFO,server,listening on port 8080,pid 4242,thread 7,ok";
+    std::string       text;
+    for (int i = 0; i < 256; ++i) {
+        text += "The quick brown fox jumps over the lazy dog. ";
+    }
+    const std::string padded = "        some token surrounded by spaces        ";
+
+    r.run("replace/short", [&]() { do_not_optimize(ut::str::replace(csv_line, "INFO", "WARN")); }, csv_line.size());
+    r.run("replace/text_11k", [&]() { do_not_optimize(ut::str::replace(text, "fox", "cat")); }, text.size());
+
+    r.run("split/key_value", [&]() { do_not_optimize(ut::str::split(short_line, '=')); }, short_line.size());
+    r.run("split/csv_8_fields", [&]() { do_not_optimize(ut::str::split(csv_line, ',')); }, csv_line.size());
+    r.run("split/text_words", [&]() { do_not_optimize(ut::str::split(text, ' ')); }, text.size());
+
+    std::vector<ut::inline_string<32, ut::inline_overflow::truncate>> inline_parts;
+    r.run("split/csv_8_fields/into_inline_string", [&]() {
+        inline_parts.clear();
+        ut::str::split(csv_line, ',', inline_parts);
+        do_not_optimize(inline_parts.data());
+    }, csv_line.size());
+
+    r.run("split_view/key_value", [&]() { do_not_optimize(ut::str::split_view<2>(short_line, '=')); }, short_line.size());
+    r.run("split_view/csv_8_fields", [&]() { do_not_optimize(ut::str::split_view<8>(csv_line, ',')); }, csv_line.size());
+
+    r.run("split_left_right/key_value", [&]() {
+        std::string      key;
+        std::string_view value;
+        do_not_optimize(ut::str::split(short_line, '=', key, value));
+        do_not_optimize(key);
+        do_not_optimize(value);
+    });
+
+    r.run("left/csv", [&]() { do_not_optimize(ut::str::left(csv_line, ",server")); });
+    r.run("trim/padded", [&]() { do_not_optimize(ut::str::trim(padded)); });
+
+    r.run("toLower/short", [&]() { do_not_optimize(ut::str::toLower("Content-Type")); });
+    r.run("toLower/short/into_inline_string", [&]() {
+        ut::inline_string<32> out;
+        ut::str::toLower("Content-Type", out);
+        do_not_optimize(out);
+    });
+    r.run("toLower/text_11k", [&]() { do_not_optimize(ut::str::toLower(text)); }, text.size());
+    r.run("toUpper/text_11k", [&]() { do_not_optimize(ut::str::toUpper(text)); }, text.size());
+
+    const std::vector<std::string_view> parts = {"usr", "local", "share", "utility.cc", "include"};
+    r.run("concat/5_parts", [&]() { do_not_optimize(ut::str::concat(parts, "/")); });
+
+    const std::array<const char *, 5> cparts = {"usr", "local", "share", "utility.cc", "include"};
+    r.run("join/5_parts", [&]() { do_not_optimize(ut::str::join(cparts, "/")); });
+
+    // search: 1 MB of log-like text, the needle near the end
+    std::string log_text;
+    while (log_text.size() < (1 << 20)) {
+        log_text += "2024-01-01 12:00:00 INFO request served in 12 ms, status ok\n";
+    }
+    log_text += "2024-01-01 12:00:01 ERROR disk full\n";
+    r.run("find/1m/std", [&]() { do_not_optimize(std::string_view(log_text).find("ERROR disk")); }, log_text.size());
+    r.run("find/1m", [&]() { do_not_optimize(ut::str::find(log_text, "ERROR disk")); }, log_text.size());
+    const ut::str::searcher error_disk("ERROR disk");
+    r.run("find/1m/searcher", [&]() { do_not_optimize(error_disk.find(log_text)); }, log_text.size());
+    const ut::str::searcher common("in 13 ms");
+    r.run("find/1m/searcher_common_bytes", [&]() { do_not_optimize(common.find(log_text)); }, log_text.size());
+    r.run("find/1m/std_common_bytes", [&]() { do_not_optimize(std::string_view(log_text).find("in 13 ms")); }, log_text.size());
+
+    const ut::str::multi_searcher markers({"ERROR", "WARN", "FATAL", "assert"});
+    std::vector<ut::str::multi_searcher::match> found;
+    r.run("multi_searcher/1m/4_patterns", [&]() {
+        found.clear();
+        markers.find_all(log_text, found);
+        do_not_optimize(found.data());
+    }, log_text.size());
+    r.run("multi_searcher/1m/4_patterns/std_find_each", [&]() {
+        size_t n = 0;
+        for (std::string_view m : {"ERROR", "WARN", "FATAL", "assert"}) {
+            for (size_t pos = 0; (pos = std::string_view(log_text).find(m, pos)) != std::string_view::npos; ++pos) {
+                ++n;
+            }
+        }
+        do_not_optimize(n);
+    }, log_text.size());
+    r.run("replace/1m", [&]() { do_not_optimize(ut::str::replace(log_text, "status ok", "ok")); }, log_text.size());
+
+    // numbers: 4096 integers / doubles, one per line
+    std::string ints, doubles;
+    for (int i = 0; i < 4096; ++i) {
+        ints += std::to_string(i * 7919 - 1000000) + "\n";
+        doubles += std::to_string(i * 0.37 - 500.0) + "\n";
+    }
+    r.run("parse<int>/single", [&]() { do_not_optimize(ut::str::parse<int>("-1234567")); });
+    r.run("parse<int>/single/stoi", [&]() { do_not_optimize(std::stoi("-1234567")); });
+    r.run("parse<uint64_t>/19_digits", [&]() { do_not_optimize(ut::str::parse<uint64_t>("1234567890123456789")); });
+    r.run("parse<double>/single", [&]() { do_not_optimize(ut::str::parse<double>("-1234.5678")); });
+    r.run("parse<double>/single/stod", [&]() { do_not_optimize(std::stod("-1234.5678")); });
+    r.run("parse_column<int>/4096", [&]() {
+        std::vector<int> out;
+        do_not_optimize(ut::str::parse_column(ints, '\n', out));
+        do_not_optimize(out);
+    }, ints.size());
+    r.run("parse_column<int>/4096/split_stoi", [&]() {
+        std::vector<int> out;
+        for (auto &tok : ut::str::split(ints, '\n')) {
+            if (!tok.empty()) {
+                out.push_back(std::stoi(std::string(tok)));
+            }
+        }
+        do_not_optimize(out);
+    }, ints.size());
+    r.run("parse_column<double>/4096", [&]() {
+        std::vector<double> out;
+        do_not_optimize(ut::str::parse_column(doubles, '\n', out));
+        do_not_optimize(out);
+    }, doubles.size());
+    r.run("parse_column<double>/4096/split_stod", [&]() {
+        std::vector<double> out;
+        for (auto &tok : ut::str::split(doubles, '\n')) {
+            if (!tok.empty()) {
+                out.push_back(std::stod(std::string(tok)));
+            }
+        }
+        do_not_optimize(out);
+    }, doubles.size());
+    r.run("format_to/double", [&]() {
+        char buf[32];
+        do_not_optimize(ut::str::format_to(std::span<char>(buf), 3.14159265358979));
+    });
+    r.run("format_to/double/to_string", [&]() { do_not_optimize(std::to_string(3.14159265358979)); });
+
+    return r.finish();
+}
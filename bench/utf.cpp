@@ -0,0 +1,53 @@
+#include <string>
+
+#include "bench.h"
+#include "utility.cc/utf.h"
+
+using ut::bench::do_not_optimize;
+
+// Validation and transcoding throughput on ASCII heavy and CJK heavy text, against a byte at a time validator
+
+static bool naive_validate(std::string_view s)
+{
+    for (size_t i = 0; i < s.size();) {
+        unsigned char c   = static_cast<unsigned char>(s[i]);
+        size_t        len = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xE ? 3 : (c >> 3) == 0x1E ? 4 : 0;
+        if (!len || i + len > s.size()) {
+            return false;
+        }
+        for (size_t k = 1; k < len; ++k) {
+            if ((static_cast<unsigned char>(s[i + k]) & 0xC0) != 0x80) {
+                return false;
+            }
+        }
+        i += len;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    ut::bench::runner r(argc, argv);
+
+    std::string ascii, mixed;
+    while (ascii.size() < (1 << 20)) {
+        ascii += "GET /index.html HTTP/1.1 200 text/html; charset=utf-8\n";
+        mixed += "日志: 请求已处理 (status ok) 用时 12 ms — ✓\n";
+    }
+
+    r.run("validate/ascii_1m", [&]() { do_not_optimize(ut::utf::validate(ascii)); }, ascii.size());
+    r.run("validate/ascii_1m/naive", [&]() { do_not_optimize(naive_validate(ascii)); }, ascii.size());
+    r.run("validate/cjk_1m", [&]() { do_not_optimize(ut::utf::validate(mixed)); }, mixed.size());
+    r.run("validate/cjk_1m/naive", [&]() { do_not_optimize(naive_validate(mixed)); }, mixed.size());
+    r.run("count_code_points/cjk_1m", [&]() { do_not_optimize(ut::utf::count_code_points(mixed)); }, mixed.size());
+
+    std::u16string u16;
+    std::u32string u32;
+    std::string    back;
+    r.run("to_utf16/ascii_1m", [&]() { do_not_optimize(ut::utf::to_utf16(ascii, u16)); }, ascii.size());
+    r.run("to_utf16/cjk_1m", [&]() { do_not_optimize(ut::utf::to_utf16(mixed, u16)); }, mixed.size());
+    r.run("to_utf32/cjk_1m", [&]() { do_not_optimize(ut::utf::to_utf32(mixed, u32)); }, mixed.size());
+    r.run("from_utf16/cjk_1m", [&]() { do_not_optimize(ut::utf::from_utf16(u16, back)); }, mixed.size());
+
+    return r.finish();
+}
@@ -0,0 +1,280 @@
+#include "utility.cc/alloc_tracker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+#include "debug.h"
+
+
+namespace ut
+{
+namespace alloc
+{
+
+namespace
+{
+
+struct header
+{
+    uint64_t size;
+    uint32_t offset;    // from the start of the raw block to the user pointer
+    bool     bInternal; // allocated by the tracker's bookkeeping: neither it nor its free is counted
+};
+static_assert(sizeof(header) == 16);
+
+std::atomic<bool>     g_bHooked{false};
+std::atomic<uint64_t> g_allocations{0}, g_frees{0}, g_bytes{0};
+std::atomic<int64_t>  g_live{0}, g_peak{0};
+
+// constant initialized, safe to touch from operator new at any point of a thread's life
+thread_local counters t_counters;
+thread_local bool     t_bInternal = false; // the tracker's own bookkeeping is not counted, see header::bInternal
+
+// the tag is owned, a scope's tag may be built at runtime and gone long before the report;
+// file comes from source_location and lives as long as the program
+struct site_key
+{
+    std::string      tag;
+    std::string_view file;
+    uint32_t         line;
+
+    bool operator<(const site_key &o) const { return std::tie(tag, file, line) < std::tie(o.tag, o.file, o.line); }
+};
+
+std::mutex &sites_mutex()
+{
+    static std::mutex m;
+    return m;
+}
+
+std::map<site_key, site> &sites()
+{
+    static std::map<site_key, site> s;
+    return s;
+}
+
+void on_alloc(uint64_t size)
+{
+    if (!g_bHooked.load(std::memory_order_relaxed)) {
+        g_bHooked.store(true, std::memory_order_relaxed);
+    }
+
+    counters &t = t_counters;
+    ++t.allocations;
+    t.bytes += size;
+    t.live_bytes += static_cast<int64_t>(size);
+    t.peak_bytes = std::max(t.peak_bytes, t.live_bytes);
+
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_bytes.fetch_add(size, std::memory_order_relaxed);
+    int64_t live = g_live.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed) + static_cast<int64_t>(size);
+    int64_t peak = g_peak.load(std::memory_order_relaxed);
+    while (live > peak && !g_peak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+}
+
+void on_free(uint64_t size)
+{
+    ++t_counters.frees;
+    t_counters.live_bytes -= static_cast<int64_t>(size);
+    g_frees.fetch_add(1, std::memory_order_relaxed);
+    g_live.fetch_sub(static_cast<int64_t>(size), std::memory_order_relaxed);
+}
+
+counters diff(const counters &now, const counters &start)
+{
+    return counters{
+        .allocations = now.allocations - start.allocations,
+        .frees       = now.frees - start.frees,
+        .bytes       = now.bytes - start.bytes,
+        .live_bytes  = now.live_bytes - start.live_bytes,
+        .peak_bytes  = 0,
+    };
+}
+
+} // namespace
+
+
+namespace detail
+{
+
+void *allocate(size_t size, size_t align, bool bNothrow)
+{
+    const size_t offset = std::max<size_t>(sizeof(header), align);
+    void        *raw    = nullptr;
+    if (offset == sizeof(header)) {
+        raw = std::malloc(size + offset); // malloc's 16 byte alignment carries over past the header
+    }
+    else {
+#if _WIN32
+        raw = _aligned_malloc(size + offset, align);
+#else
+        raw = std::aligned_alloc(align, (size + offset + align - 1) / align * align);
+#endif
+    }
+    if (!raw) {
+        if (bNothrow) {
+            return nullptr;
+        }
+        throw std::bad_alloc();
+    }
+
+    char *p = static_cast<char *>(raw) + offset;
+    // the flag travels with the block, so its free matches wherever and whenever it happens
+    *reinterpret_cast<header *>(p - sizeof(header)) = header{.size = size, .offset = static_cast<uint32_t>(offset), .bInternal = t_bInternal};
+    if (!t_bInternal) {
+        on_alloc(size);
+    }
+    return p;
+}
+
+void deallocate(void *ptr) noexcept
+{
+    if (!ptr) {
+        return;
+    }
+    char        *p = static_cast<char *>(ptr);
+    const header h = *reinterpret_cast<header *>(p - sizeof(header));
+    if (!h.bInternal) {
+        on_free(h.size);
+    }
+#if _WIN32
+    if (h.offset != sizeof(header)) {
+        _aligned_free(p - h.offset);
+        return;
+    }
+#endif
+    std::free(p - h.offset);
+}
+
+} // namespace detail
+
+
+bool hooked()
+{
+    return g_bHooked.load(std::memory_order_relaxed);
+}
+
+counters totals()
+{
+    return counters{
+        .allocations = g_allocations.load(std::memory_order_relaxed),
+        .frees       = g_frees.load(std::memory_order_relaxed),
+        .bytes       = g_bytes.load(std::memory_order_relaxed),
+        .live_bytes  = g_live.load(std::memory_order_relaxed),
+        .peak_bytes  = g_peak.load(std::memory_order_relaxed),
+    };
+}
+
+counters thread_totals()
+{
+    return t_counters;
+}
+
+std::vector<site> report()
+{
+    t_bInternal = true;
+    std::vector<site> ret;
+    {
+        std::lock_guard lock(sites_mutex());
+        for (auto &[key, s] : sites()) {
+            ret.push_back(s);
+        }
+    }
+    std::sort(ret.begin(), ret.end(), [](const site &a, const site &b) { return a.total.bytes > b.total.bytes; });
+    t_bInternal = false;
+    return ret;
+}
+
+void reset()
+{
+    t_bInternal = true;
+    {
+        std::lock_guard lock(sites_mutex());
+        sites().clear();
+    }
+    g_allocations = 0;
+    g_frees       = 0;
+    g_bytes       = 0;
+    g_live        = 0;
+    g_peak        = 0;
+    t_bInternal   = false;
+}
+
+
+namespace
+{
+// copying the tag is bookkeeping, not an allocation of the scope or the code around it
+std::string own(std::string_view tag)
+{
+    t_bInternal = true;
+    std::string ret(tag);
+    t_bInternal = false;
+    return ret;
+}
+} // namespace
+
+scope::scope(std::string_view tag, std::source_location loc)
+    : _tag(own(tag)), _loc(loc), _start(t_counters), _outer_peak(t_counters.peak_bytes)
+{
+    // measure this scope's peak from where it starts
+    t_counters.peak_bytes = t_counters.live_bytes;
+}
+
+counters scope::so_far() const
+{
+    counters c   = diff(t_counters, _start);
+    c.peak_bytes = t_counters.peak_bytes - _start.live_bytes;
+    return c;
+}
+
+scope::~scope()
+{
+    const counters c = so_far();
+    t_counters.peak_bytes = std::max(_outer_peak, t_counters.peak_bytes);
+
+    t_bInternal = true;
+    {
+        std::lock_guard lock(sites_mutex());
+        site &s = sites()[site_key{.tag = _tag, .file = _loc.file_name(), .line = _loc.line()}];
+        if (s.runs == 0) {
+            s.tag  = _tag;
+            s.file = _loc.file_name();
+            s.line = _loc.line();
+        }
+        ++s.runs;
+        s.total.allocations += c.allocations;
+        s.total.frees += c.frees;
+        s.total.bytes += c.bytes;
+        s.total.live_bytes += c.live_bytes;
+        s.total.peak_bytes = std::max(s.total.peak_bytes, c.peak_bytes);
+    }
+    t_bInternal = false;
+}
+
+
+expect_allocs::expect_allocs(uint64_t max_allocations, std::source_location loc)
+    : _max(max_allocations), _start(t_counters.allocations), _loc(loc)
+{
+}
+
+expect_allocs::~expect_allocs()
+{
+    const uint64_t n = t_counters.allocations - _start;
+    if (n > _max) {
+        log{_loc}, "expected at most", _max, "heap allocations, got", n;
+        std::abort();
+    }
+}
+
+} // namespace alloc
+} // namespace ut
+
+
+#if UTILITY_ALLOC_TRACKING
+UT_ALLOC_DEFINE_HOOKS()
+#endif
@@ -0,0 +1,439 @@
+#include "utility.cc/blob_store.h"
+
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <random>
+
+#if __linux__
+    #include <fcntl.h>
+    #include <linux/fs.h>
+    #include <sys/ioctl.h>
+    #include <unistd.h>
+#endif
+
+#include "debug.h"
+#include "xxhash.h"
+
+
+namespace ut
+{
+
+blob_digest blob_digest::of(std::string_view bytes)
+{
+    return blob_digest{.hash = xxhash::hash64(bytes), .size = bytes.size()};
+}
+
+std::string blob_digest::str() const
+{
+    std::string ret(16, '0');
+    for (int i = 0; i < 16; ++i) {
+        ret[i] = "0123456789abcdef"[(hash >> ((15 - i) * 4)) & 0xF];
+    }
+    ret += '-';
+    ret += std::to_string(size);
+    if (variant) {
+        ret += '-';
+        ret += std::to_string(variant);
+    }
+    return ret;
+}
+
+std::optional<blob_digest> blob_digest::parse(std::string_view text)
+{
+    blob_digest d;
+    if (text.size() < 18 || text[16] != '-') {
+        return std::nullopt;
+    }
+    auto r = std::from_chars(text.data(), text.data() + 16, d.hash, 16);
+    if (r.ec != std::errc() || r.ptr != text.data() + 16) {
+        return std::nullopt;
+    }
+
+    const char *end = text.data() + text.size();
+    r               = std::from_chars(text.data() + 17, end, d.size);
+    if (r.ec != std::errc() || d.size >> 56) {
+        return std::nullopt;
+    }
+    if (r.ptr != end) {
+        unsigned variant = 0;
+        if (*r.ptr != '-') {
+            return std::nullopt;
+        }
+        r = std::from_chars(r.ptr + 1, end, variant);
+        if (r.ec != std::errc() || r.ptr != end || variant == 0 || variant > 255) {
+            return std::nullopt;
+        }
+        d.variant = static_cast<uint8_t>(variant);
+    }
+    return d;
+}
+
+
+namespace
+{
+
+// bump when object names or the layout change; the hash is part of it, names computed with another one never match
+constexpr std::string_view STORE_FORMAT = "ut-blob-store 1 xxh64\n";
+
+bool check_format(const std::filesystem::path &root)
+{
+    const auto    filepath = root / "format";
+    std::ifstream in(filepath, std::ios::binary);
+    if (in.is_open()) {
+        std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        if (text != STORE_FORMAT) {
+            log(), "Unsupported blob store format", filepath;
+            return false;
+        }
+        return true;
+    }
+
+    // new, or written before the format was recorded, when names were std::hash values
+    std::error_code ec;
+    if (!std::filesystem::is_empty(root / "objects", ec) || ec) {
+        log(), "Blob store written by an older build, delete it to start over:", root;
+        return false;
+    }
+    std::ofstream out(filepath, std::ios::binary | std::ios::trunc);
+    if (!out.write(STORE_FORMAT.data(), static_cast<std::streamsize>(STORE_FORMAT.size())) || !out.flush()) {
+        log(), "Failed to write", filepath;
+        return false;
+    }
+    return true;
+}
+
+// copy on write clone of a whole file, false where the filesystem (or the platform) can't
+bool reflink(const std::filesystem::path &from, const std::filesystem::path &to)
+{
+#if __linux__ && defined(FICLONE)
+    int in = ::open(from.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        return false;
+    }
+    int  out     = ::open(to.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    bool bCloned = out >= 0 && ::ioctl(out, FICLONE, in) == 0;
+    if (out >= 0) {
+        ::close(out);
+        if (!bCloned) {
+            ::unlink(to.c_str());
+        }
+    }
+    ::close(in);
+    return bCloned;
+#else
+    (void)from;
+    (void)to;
+    return false;
+#endif
+}
+
+void make_read_only(const std::filesystem::path &filepath)
+{
+    std::error_code ec;
+    std::filesystem::permissions(filepath,
+                                 std::filesystem::perms::owner_write | std::filesystem::perms::group_write | std::filesystem::perms::others_write,
+                                 std::filesystem::perm_options::remove, ec);
+}
+
+uint64_t slot_hash(uint64_t hash, uint64_t size_variant)
+{
+    // the content hash is already mixed, fold the size in with a multiplicative step
+    return hash ^ (size_variant * 0x9E3779B97F4A7C15ull);
+}
+
+} // namespace
+
+
+bool blob_store::index::contains(const blob_digest &d) const
+{
+    return find(d) != std::string::npos;
+}
+
+size_t blob_store::index::find(const blob_digest &d) const
+{
+    if (_slots.empty()) {
+        return std::string::npos;
+    }
+    const uint64_t key  = d.size << 8 | d.variant;
+    const size_t   mask = _slots.size() - 1;
+    for (size_t i = slot_hash(d.hash, key) & mask;; i = (i + 1) & mask) {
+        if (_slots[i].size_variant == empty) {
+            return std::string::npos;
+        }
+        if (_slots[i].hash == d.hash && _slots[i].size_variant == key) {
+            return i;
+        }
+    }
+}
+
+void blob_store::index::insert(const blob_digest &d)
+{
+    if (contains(d)) {
+        return;
+    }
+    if ((_count + 1) * 10 > _slots.size() * 7) { // load factor 0.7
+        grow();
+    }
+    const uint64_t key  = d.size << 8 | d.variant;
+    const size_t   mask = _slots.size() - 1;
+    size_t         i    = slot_hash(d.hash, key) & mask;
+    while (_slots[i].size_variant != empty) {
+        i = (i + 1) & mask;
+    }
+    _slots[i] = slot{.hash = d.hash, .size_variant = key};
+    ++_count;
+}
+
+bool blob_store::index::erase(const blob_digest &d)
+{
+    size_t i = find(d);
+    if (i == std::string::npos) {
+        return false;
+    }
+    // backward shift deletion: no tombstones, probe chains stay short
+    const size_t mask = _slots.size() - 1;
+    for (size_t j = (i + 1) & mask; _slots[j].size_variant != empty; j = (j + 1) & mask) {
+        size_t home = slot_hash(_slots[j].hash, _slots[j].size_variant) & mask;
+        // move j into the hole at i unless its home lies cyclically in (i, j]
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            _slots[i] = _slots[j];
+            i         = j;
+        }
+    }
+    _slots[i].size_variant = empty;
+    --_count;
+    return true;
+}
+
+void blob_store::index::grow()
+{
+    std::vector<slot> old = std::move(_slots);
+    _slots.assign(old.empty() ? 64 : old.size() * 2, slot{.hash = 0, .size_variant = empty});
+    _count = 0;
+    for (const slot &s : old) {
+        if (s.size_variant != empty) {
+            insert(blob_digest{.hash = s.hash, .size = s.size_variant >> 8, .variant = static_cast<uint8_t>(s.size_variant & 0xFF)});
+        }
+    }
+}
+
+
+blob_store::blob_store(const std::filesystem::path &root) : blob_store(root, options{}) {}
+
+blob_store::blob_store(const std::filesystem::path &root, options opt) : _root(root), _opt(opt)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(_root / "objects", ec);
+    std::filesystem::create_directories(_root / "tmp", ec);
+    if (ec) {
+        log(), "Failed to create blob store at", _root, ec.message();
+        return;
+    }
+    if (!check_format(_root)) {
+        return;
+    }
+    _bValid = true;
+    load_index();
+}
+
+void blob_store::load_index()
+{
+    std::error_code ec;
+    for (auto it = std::filesystem::recursive_directory_iterator(_root / "objects", ec);
+         !ec && it != std::filesystem::recursive_directory_iterator();
+         it.increment(ec))
+    {
+        if (it->is_regular_file(ec)) {
+            if (auto d = blob_digest::parse(it->path().filename().string())) {
+                _index.insert(*d);
+            }
+        }
+    }
+}
+
+std::filesystem::path blob_store::path_of(const blob_digest &digest) const
+{
+    const std::string name = digest.str();
+    return _root / "objects" / name.substr(0, 2) / name.substr(2, 2) / name;
+}
+
+std::filesystem::path blob_store::temp_path() const
+{
+    static std::atomic<uint64_t> counter{0};
+    static const uint64_t        salt = std::random_device{}() | uint64_t(std::random_device{}()) << 32;
+
+    const uint64_t now = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    return _root / "tmp" / blob_digest{.hash = salt ^ now, .size = counter.fetch_add(1)}.str();
+}
+
+bool blob_store::contains(const blob_digest &digest) const
+{
+    std::shared_lock lock(_mutex);
+    return _index.contains(digest);
+}
+
+size_t blob_store::size() const
+{
+    std::shared_lock lock(_mutex);
+    return _index.size();
+}
+
+std::optional<file::mapped_file> blob_store::open(const blob_digest &digest) const
+{
+    if (!contains(digest)) {
+        return std::nullopt;
+    }
+    return file::mapped_file::open(path_of(digest));
+}
+
+
+std::optional<blob_digest> blob_store::put(std::string_view bytes)
+{
+    return store(blob_digest::of(bytes), bytes, nullptr, false);
+}
+
+std::optional<blob_digest> blob_store::put_file(const std::filesystem::path &filepath, bool bAllowHardlink)
+{
+    auto source = file::mapped_file::open(filepath);
+    if (!source) {
+        return std::nullopt;
+    }
+    return store(blob_digest::of(source->view()), source->view(), &filepath, bAllowHardlink);
+}
+
+std::optional<blob_digest> blob_store::store(const blob_digest &base, std::string_view bytes, const std::filesystem::path *source, bool bAllowHardlink)
+{
+    if (!_bValid) {
+        return std::nullopt;
+    }
+    if (base.size >> 56) {
+        // the index packs size << 8 | variant, and parse() refuses such names
+        log(), "Blob too large for a digest", base.size;
+        return std::nullopt;
+    }
+
+    unsigned variant = 0;
+    while (variant <= 255) {
+        blob_digest d = base;
+        d.variant     = static_cast<uint8_t>(variant);
+
+        const auto      final = path_of(d);
+        std::error_code ec;
+        if (contains(d) || std::filesystem::exists(final, ec)) {
+            if (!_opt.bVerifyOnHit) {
+                std::unique_lock lock(_mutex);
+                _index.insert(d);
+                return d;
+            }
+            auto existing = file::mapped_file::open(final);
+            if (existing && existing->view() == bytes) {
+                std::unique_lock lock(_mutex);
+                _index.insert(d);
+                return d;
+            }
+            if (existing) {
+                ++variant; // a different blob with the same hash and size
+                continue;
+            }
+            // indexed but gone from disk: write it again
+        }
+
+        std::filesystem::create_directories(final.parent_path(), ec);
+
+        // hard linking the source is itself atomic and fails if the object appeared meanwhile
+        if (source && bAllowHardlink && !std::filesystem::exists(final, ec)) {
+            std::filesystem::create_hard_link(*source, final, ec);
+            if (!ec) {
+                std::unique_lock lock(_mutex);
+                _index.insert(d);
+                return d;
+            }
+        }
+
+        const auto tmp     = temp_path();
+        bool       bStaged = source && reflink(*source, tmp);
+        if (!bStaged) {
+            std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+            bStaged = f.write(bytes.data(), static_cast<std::streamsize>(bytes.size())) && f.flush();
+        }
+        if (!bStaged) {
+            log(), "Failed to write blob", tmp;
+            std::filesystem::remove(tmp, ec);
+            return std::nullopt;
+        }
+        make_read_only(tmp);
+
+        // link + unlink instead of rename: never replaces an object another writer just stored
+        std::filesystem::create_hard_link(tmp, final, ec);
+        std::error_code rm_ec;
+        std::filesystem::remove(tmp, rm_ec);
+        if (ec && !std::filesystem::exists(final, rm_ec)) {
+            log(), "Failed to store blob", final, ec.message();
+            return std::nullopt;
+        }
+        if (ec) {
+            continue; // lost the race, verify what the other writer stored
+        }
+
+        std::unique_lock lock(_mutex);
+        _index.insert(d);
+        return d;
+    }
+
+    log(), "Too many blobs share hash and size", base.str();
+    return std::nullopt;
+}
+
+
+bool blob_store::export_to(const blob_digest &digest, const std::filesystem::path &dest, bool bAllowHardlink) const
+{
+    const auto      src = path_of(digest);
+    std::error_code ec;
+    if (!contains(digest) || !std::filesystem::exists(src, ec)) {
+        log(), "No such blob", digest.str();
+        return false;
+    }
+
+    auto tmp = dest;
+    tmp += ".tmp-" + temp_path().filename().string();
+
+    bool bPlaced = reflink(src, tmp);
+    if (!bPlaced && bAllowHardlink) {
+        std::filesystem::create_hard_link(src, tmp, ec);
+        bPlaced = !ec;
+    }
+    if (!bPlaced) {
+        // copy_file takes the object's read only mode along, the reflink above gives a writable file
+        bPlaced = std::filesystem::copy_file(src, tmp, ec);
+        if (bPlaced) {
+            std::filesystem::permissions(tmp, std::filesystem::perms::owner_write, std::filesystem::perm_options::add, ec);
+        }
+    }
+    if (bPlaced) {
+        std::filesystem::rename(tmp, dest, ec);
+    }
+    if (!bPlaced || ec) {
+        log(), "Failed to export blob", digest.str(), "to", dest, ec.message();
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+bool blob_store::remove(const blob_digest &digest)
+{
+    std::unique_lock lock(_mutex);
+    if (!_index.erase(digest)) {
+        return false;
+    }
+    std::error_code ec;
+    std::filesystem::remove(path_of(digest), ec);
+    return !ec;
+}
+
+} // namespace ut
@@ -1,14 +1,334 @@
 
 
 #pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string_view>
 #include <type_traits>
+#include <utility>
 
 
+// args are passed on as lvalues: every iteration sees the same objects, nothing is moved out
 template <int StartIndex, int UpperBound, class Fn, class... Arg>
-void static_for(Fn func, Arg... args)
+void static_for(Fn &&func, Arg &&...args)
 {
     if constexpr (StartIndex < UpperBound) {
-        func(std::integral_constant<int, StartIndex>{}, std::forward<Arg>(args)...);
-        static_for<StartIndex + 1, UpperBound>(func, std::forward<Arg>(args)...);
+        func(std::integral_constant<int, StartIndex>{}, args...);
+        static_for<StartIndex + 1, UpperBound>(func, args...);
     }
 }
+
+
+namespace ut
+{
+
+namespace detail
+{
+
+template <typename T>
+constexpr long long to_dispatch_index(T v)
+{
+    if constexpr (std::is_enum_v<T>) {
+        return static_cast<long long>(static_cast<std::underlying_type_t<T>>(v));
+    }
+    else {
+        return static_cast<long long>(v);
+    }
+}
+
+} // namespace detail
+
+
+/**
+ * One runtime parameter of a dispatch, the closed range [Lo, Hi] of an integer/enum/bool type
+ *  e.g. ut::dispatch_axis<Format::UNKNOWN, Format::TIFF>{info.format}
+ */
+template <auto Lo, auto Hi>
+struct dispatch_axis
+{
+    using value_type = decltype(Lo);
+    static_assert(std::is_same_v<value_type, decltype(Hi)>, "Lo and Hi must have the same type");
+    static_assert(std::is_integral_v<value_type> || std::is_enum_v<value_type>);
+
+    static constexpr long long lo = detail::to_dispatch_index(Lo);
+    static constexpr long long hi = detail::to_dispatch_index(Hi);
+    static_assert(lo <= hi);
+    static constexpr size_t count = static_cast<size_t>(hi - lo + 1);
+
+    static constexpr value_type value_at(size_t i) { return static_cast<value_type>(lo + static_cast<long long>(i)); }
+
+    value_type value;
+
+    constexpr bool   in_range() const { return detail::to_dispatch_index(value) >= lo && detail::to_dispatch_index(value) <= hi; }
+    constexpr size_t index() const { return static_cast<size_t>(detail::to_dispatch_index(value) - lo); }
+};
+
+
+namespace detail
+{
+
+template <typename T>
+inline constexpr bool is_dispatch_axis = false;
+template <auto Lo, auto Hi>
+inline constexpr bool is_dispatch_axis<dispatch_axis<Lo, Hi>> = true;
+
+template <typename... Axis>
+struct dispatch_grid
+{
+    static constexpr size_t counts[] = {Axis::count...};
+    static constexpr size_t size     = (Axis::count * ... * size_t(1));
+
+    // index of axis `k` inside the flat table index, the first axis is the most significant
+    static constexpr size_t digit(size_t flat, size_t k)
+    {
+        size_t stride = 1;
+        for (size_t j = k + 1; j < sizeof...(Axis); ++j) {
+            stride *= counts[j];
+        }
+        return flat / stride % counts[k];
+    }
+
+    static constexpr size_t flat_index(const Axis &...axes)
+    {
+        size_t flat = 0;
+        ((flat = flat * Axis::count + axes.index()), ...);
+        return flat;
+    }
+};
+
+template <typename Fn, typename... Axis>
+using dispatch_result_t = std::invoke_result_t<Fn &, std::integral_constant<typename Axis::value_type, Axis::value_at(0)>...>;
+
+template <typename R, typename Fn, size_t Flat, typename... Axis, size_t... K>
+constexpr R dispatch_entry_impl(Fn &fn, std::index_sequence<K...>)
+{
+    using grid = dispatch_grid<Axis...>;
+    return fn(std::integral_constant<typename Axis::value_type, Axis::value_at(grid::digit(Flat, K))>{}...);
+}
+
+// one instantiation per combination of values
+template <typename R, typename Fn, size_t Flat, typename... Axis>
+constexpr R dispatch_entry(Fn &fn)
+{
+    return dispatch_entry_impl<R, Fn, Flat, Axis...>(fn, std::index_sequence_for<Axis...>{});
+}
+
+template <typename R, typename Fn, typename... Axis, size_t... Flat>
+constexpr auto make_dispatch_table(std::index_sequence<Flat...>)
+{
+    return std::array<R (*)(Fn &), sizeof...(Flat)>{&dispatch_entry<R, Fn, Flat, Axis...>...};
+}
+
+} // namespace detail
+
+
+/**
+ * Multi dimensional dispatch: calls fn(std::integral_constant<...>{}...) with one constant per axis.
+ * The table of specialized instantiations is built at compile time, the runtime cost is one indirect call.
+ * Every instantiation must return the same type.
+ *
+ *   ut::dispatch([&](auto fmt, auto channels) { return decode<fmt(), channels()>(data); },
+ *                ut::dispatch_axis<Format::UNKNOWN, Format::TIFF>{info.format},
+ *                ut::dispatch_axis<1, 4>{channel_count});
+ *
+ * @throws std::out_of_range if a value is outside of its axis
+ */
+template <typename Fn, typename... Axis>
+    requires(sizeof...(Axis) > 0 && (detail::is_dispatch_axis<Axis> && ...))
+constexpr decltype(auto) dispatch(Fn &&fn, Axis... axes)
+{
+    using R    = detail::dispatch_result_t<Fn, Axis...>;
+    using grid = detail::dispatch_grid<Axis...>;
+
+    constexpr auto table = detail::make_dispatch_table<R, std::remove_reference_t<Fn>, Axis...>(std::make_index_sequence<grid::size>{});
+
+    if (!(axes.in_range() && ...)) {
+        throw std::out_of_range("ut::dispatch: value out of range");
+    }
+    return table[grid::flat_index(axes...)](fn);
+}
+
+/**
+ * Turn a runtime value in [Lo, Hi] into a template argument, replaces hand written switch ladders:
+ *
+ *   ut::dispatch<1, 16>(simd_width, [&](auto width) { kernel<width()>(data); });
+ *
+ * @throws std::out_of_range if the value is outside of [Lo, Hi]
+ */
+template <auto Lo, auto Hi, typename Fn>
+constexpr decltype(auto) dispatch(decltype(Lo) value, Fn &&fn)
+{
+    return dispatch(std::forward<Fn>(fn), dispatch_axis<Lo, Hi>{value});
+}
+
+/**
+ * Same as above, but out of range values go to fallback(value) instead of throwing
+ */
+template <auto Lo, auto Hi, typename Fn, typename Fallback>
+constexpr decltype(auto) dispatch(decltype(Lo) value, Fn &&fn, Fallback &&fallback)
+{
+    if (!dispatch_axis<Lo, Hi>{value}.in_range()) {
+        return static_cast<detail::dispatch_result_t<Fn, dispatch_axis<Lo, Hi>>>(fallback(value));
+    }
+    return dispatch(std::forward<Fn>(fn), dispatch_axis<Lo, Hi>{value});
+}
+
+
+/* compile time string hashing */
+
+/**
+ * 64 bit FNV-1a, the same value at compile time and at runtime on every platform (unlike std::hash)
+ *
+ *   switch (ut::fnv1a(key)) {
+ *   case "width"_h: ...
+ *   }
+ * Two keys with the same hash won't compile as case labels, but an unknown string can still hash to a case:
+ * compare the key in the case, or use perfect_hash below which does.
+ */
+constexpr uint64_t fnv1a(std::string_view text, uint64_t seed = 0xCBF29CE484222325ull)
+{
+    uint64_t h = seed;
+    for (char c : text) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 0x100000001B3ull;
+    }
+    return h;
+}
+
+inline namespace literals
+{
+consteval uint64_t operator""_h(const char *text, size_t n) { return fnv1a({text, n}); }
+} // namespace literals
+
+
+namespace detail
+{
+
+// splitmix64 finalizer, spreads fnv1a's weak low bits before they pick a slot
+constexpr uint64_t perfect_hash_mix(uint64_t h, uint32_t displace)
+{
+    h ^= displace * 0x9E3779B97F4A7C15ull;
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBull;
+    h ^= h >> 31;
+    return h;
+}
+
+} // namespace detail
+
+/**
+ * Collision free table over a fixed set of keys, built at compile time (hash and displace):
+ *  find() is one fnv1a, two array reads and one string compare, no runtime setup
+ *
+ *   constexpr auto commands = ut::make_perfect_hash({"run", "stop", "status"});
+ *   switch (commands.find(cmd)) {
+ *   case commands.find("run"): ...
+ *   case commands.npos:        // not a command
+ *   }
+ *
+ * The keys are kept as string_views, build from literals or other static storage.
+ * @throws std::invalid_argument for duplicate keys, which fails the build in a constexpr context
+ */
+template <size_t N>
+class perfect_hash
+{
+  public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    constexpr explicit perfect_hash(const std::array<std::string_view, N> &keys) : _keys(keys)
+    {
+        std::array<uint64_t, N> hashes{};
+        std::array<size_t, N>   order{};
+        for (size_t i = 0; i < N; ++i) {
+            hashes[i] = fnv1a(keys[i]);
+            order[i]  = i;
+        }
+
+        // equal neighbours after sorting by hash are duplicates (or a real 64 bit collision)
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return hashes[a] < hashes[b]; });
+        for (size_t i = 1; i < N; ++i) {
+            if (hashes[order[i]] == hashes[order[i - 1]]) {
+                throw std::invalid_argument(keys[order[i]] == keys[order[i - 1]] ? "ut::perfect_hash: duplicate key" : "ut::perfect_hash: 64 bit hash collision");
+            }
+        }
+
+        // group the keys by bucket, biggest buckets first while most slots are still free
+        std::array<size_t, bucket_count> sizes{};
+        for (size_t i = 0; i < N; ++i) {
+            ++sizes[bucket_of(hashes[i])];
+        }
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            const size_t ba = bucket_of(hashes[a]), bb = bucket_of(hashes[b]);
+            return sizes[ba] != sizes[bb] ? sizes[ba] > sizes[bb] : ba < bb;
+        });
+
+        std::array<size_t, N> tried{};
+        for (size_t first = 0; first < N;) {
+            const size_t b     = bucket_of(hashes[order[first]]);
+            const size_t count = sizes[b];
+
+            for (uint32_t d = 0;; ++d) {
+                if (d == max_displace) {
+                    throw std::invalid_argument("ut::perfect_hash: no displacement found");
+                }
+                bool bFits = true;
+                for (size_t k = 0; k < count && bFits; ++k) {
+                    tried[k] = slot_of(hashes[order[first + k]], d);
+                    bFits    = _slots[tried[k]] == 0 && std::find(tried.begin(), tried.begin() + k, tried[k]) == tried.begin() + k;
+                }
+                if (bFits) {
+                    _displace[b] = d;
+                    for (size_t k = 0; k < count; ++k) {
+                        _slots[tried[k]] = static_cast<uint32_t>(order[first + k] + 1);
+                    }
+                    break;
+                }
+            }
+            first += count;
+        }
+    }
+
+    // index of key in the list the table was built from, npos if it isn't one of them
+    constexpr size_t find(std::string_view key) const
+    {
+        if constexpr (N == 0) {
+            return npos;
+        }
+        const uint64_t h     = fnv1a(key);
+        const uint32_t entry = _slots[slot_of(h, _displace[bucket_of(h)])];
+        return entry && _keys[entry - 1] == key ? entry - 1 : npos;
+    }
+
+    constexpr bool             contains(std::string_view key) const { return find(key) != npos; }
+    constexpr std::string_view key(size_t index) const { return _keys[index]; }
+    static constexpr size_t    size() { return N; }
+
+  private:
+    static constexpr size_t   bucket_count = std::bit_ceil(N ? N : size_t(1));
+    static constexpr size_t   slot_count   = 2 * bucket_count; // half full at most, displacements are found in a few tries
+    static constexpr uint32_t max_displace = 1 << 16;
+
+    static constexpr size_t bucket_of(uint64_t h) { return h & (bucket_count - 1); }
+    static constexpr size_t slot_of(uint64_t h, uint32_t displace) { return detail::perfect_hash_mix(h, displace) & (slot_count - 1); }
+
+    std::array<std::string_view, N>    _keys{};
+    std::array<uint32_t, bucket_count> _displace{};
+    std::array<uint32_t, slot_count>   _slots{}; // key index + 1, 0 is empty
+};
+
+template <size_t N>
+constexpr perfect_hash<N> make_perfect_hash(const std::string_view (&keys)[N])
+{
+    std::array<std::string_view, N> list{};
+    std::copy(keys, keys + N, list.begin());
+    return perfect_hash<N>(list);
+}
+
+} // namespace ut
@@ -0,0 +1,254 @@
+#include "utility.cc/csv.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#include "debug.h"
+#include "simd_utils.h"
+#include "utility.cc/parallel.h"
+
+
+namespace ut
+{
+namespace csv
+{
+
+reader::reader(std::string_view buffer, options opt)
+    : _opt(opt), _data(buffer), _bEof(true)
+{
+}
+
+reader::reader(std::unique_ptr<std::ifstream> file, options opt)
+    : _opt(opt), _file(std::move(file))
+{
+}
+
+std::optional<reader> reader::open(const std::filesystem::path &filepath, options opt)
+{
+    auto f = std::make_unique<std::ifstream>(filepath, std::ios::binary);
+    if (!f->is_open()) {
+        log(), "Failed to open file:", filepath;
+        return std::nullopt;
+    }
+    return reader(std::move(f), opt);
+}
+
+
+void reader::index()
+{
+    // small windows keep _structurals in cache; whole blocks only until the end of the data, so the quote carry stays exact
+    constexpr size_t max_window = 16 * 1024;
+    const size_t     window     = (std::clamp<size_t>(_opt.chunk_size, 64, max_window) + 63) & ~size_t(63);
+    const size_t     end        = std::min(_data.size(), _indexed_end + window);
+
+    _structurals.resize(window + 64);
+    _window_begin    = _indexed_end;
+    _next_structural = 0;
+
+    uint32_t *out = _structurals.data();
+    for (size_t i = _indexed_end; i < end; i += 64) {
+        const size_t n     = std::min<size_t>(64, end - i);
+        uint64_t     quote = 0, split = 0;
+        if (n == 64) {
+            simd::block64 b(_data.data() + i);
+            quote = b.eq(_opt.quote);
+            split = b.eq(_opt.delimiter) | b.eq('\n');
+        }
+        else {
+            simd::tail_block tail(_data.data() + i, n);
+            simd::block64    b(tail.bytes);
+            const uint64_t   valid = (uint64_t(1) << n) - 1;
+            quote                  = b.eq(_opt.quote) & valid;
+            split                  = (b.eq(_opt.delimiter) | b.eq('\n')) & valid;
+        }
+
+        const uint64_t inside = simd::prefix_xor(quote) ^ _inside_mask;
+        _inside_mask          = uint64_t(int64_t(inside) >> 63);
+
+        out = simd::write_bit_positions(split & ~inside, static_cast<uint32_t>(i - _window_begin), out);
+    }
+    _structural_count = static_cast<size_t>(out - _structurals.data());
+    _indexed_end      = end;
+}
+
+bool reader::refill()
+{
+    if (!_file || _bEof) {
+        return false;
+    }
+
+    // keep the unfinished record at the front, the views into it are rebuilt by next()
+    const size_t keep = _chunk.size() - _cursor;
+    if (keep) {
+        std::memmove(_chunk.data(), _chunk.data() + _cursor, keep);
+    }
+    _chunk.resize(keep + _opt.chunk_size);
+
+    _file->read(_chunk.data() + keep, static_cast<std::streamsize>(_opt.chunk_size));
+    const size_t got = static_cast<size_t>(_file->gcount());
+    if (got < _opt.chunk_size) {
+        if (_file->bad()) {
+            log(), "Failed to read csv input";
+        }
+        _bEof = true;
+    }
+    _chunk.resize(keep + got);
+
+    _data            = std::string_view(_chunk.data(), _chunk.size());
+    _cursor          = 0;
+    _indexed_end     = 0;
+    _inside_mask     = 0; // a record never starts inside quotes
+    _next_structural  = 0;
+    _structural_count = 0;
+    // the kept record moved even when nothing was read (input ending on a chunk boundary)
+    return true;
+}
+
+std::string_view reader::field(size_t begin, size_t end, bool bLast)
+{
+    std::string_view raw = _data.substr(begin, end - begin);
+    if (bLast && !raw.empty() && raw.back() == '\r') {
+        raw.remove_suffix(1);
+    }
+    if (raw.size() < 2 || raw.front() != _opt.quote || raw.back() != _opt.quote) {
+        return raw;
+    }
+
+    std::string_view inner = raw.substr(1, raw.size() - 2);
+    if (inner.find(_opt.quote) == std::string_view::npos) {
+        return inner;
+    }
+
+    // only fields with "" escapes are copied
+    std::string &s = _unescaped.emplace_back();
+    s.reserve(inner.size());
+    for (size_t i = 0; i < inner.size(); ++i) {
+        s.push_back(inner[i]);
+        if (inner[i] == _opt.quote && i + 1 < inner.size() && inner[i + 1] == _opt.quote) {
+            ++i;
+        }
+    }
+    return s;
+}
+
+bool reader::next(row &out)
+{
+    _fields.clear();
+    if (!_unescaped.empty()) {
+        _unescaped.clear();
+    }
+
+    size_t field_begin = _cursor;
+    while (true) {
+        // hot loop on locals, the member copies are written back when the window runs out
+        const uint32_t *structurals = _structurals.data();
+        const size_t    count       = _structural_count;
+        const size_t    base        = _window_begin;
+        const char     *data        = _data.data();
+        size_t          next        = _next_structural;
+        while (next < count) {
+            const size_t pos     = base + structurals[next++];
+            const bool   bRecord = data[pos] == '\n';
+            const char  *p       = data + field_begin;
+            const size_t n       = pos - field_begin;
+            if (n && (*p == _opt.quote || (bRecord && p[n - 1] == '\r'))) {
+                _fields.push_back(field(field_begin, pos, bRecord));
+            }
+            else {
+                _fields.emplace_back(p, n);
+            }
+            field_begin = pos + 1;
+            if (bRecord) {
+                _next_structural = next;
+                _cursor          = field_begin;
+                ++_records;
+                out = _fields;
+                return true;
+            }
+        }
+        _next_structural = next;
+
+        if (_indexed_end < _data.size()) {
+            index();
+            continue;
+        }
+        if (refill()) {
+            // the chunk moved, start the record over
+            _fields.clear();
+            _unescaped.clear();
+            field_begin = _cursor;
+            continue;
+        }
+
+        // end of input: an unterminated last record, or nothing left
+        if (field_begin >= _data.size() && _fields.empty()) {
+            _cursor = _data.size();
+            return false;
+        }
+        _fields.push_back(field(field_begin, _data.size(), true));
+        _cursor = _data.size();
+        ++_records;
+        out = _fields;
+        return true;
+    }
+}
+
+
+std::vector<std::string_view> split_records(std::string_view buffer, size_t parts, options opt)
+{
+    if (parts <= 1 || buffer.size() < parts * 64) {
+        return {buffer};
+    }
+
+    // quotes per equal sized segment, in parallel
+    const size_t        segment = buffer.size() / parts;
+    std::vector<size_t> quotes(parts, 0);
+    parallel_for(
+        0, parts, [&](size_t k) {
+            const size_t begin = k * segment;
+            const size_t end   = k + 1 == parts ? buffer.size() : begin + segment;
+            size_t       count = 0;
+            size_t       i     = begin;
+            for (; i + 64 <= end; i += 64) {
+                count += std::popcount(simd::block64(buffer.data() + i).eq(opt.quote));
+            }
+            count += static_cast<size_t>(std::count(buffer.data() + i, buffer.data() + end, opt.quote));
+            quotes[k] = count;
+        },
+        {.grain = 1});
+
+    // from each cut, with the parity known, move forward to the first unquoted newline
+    std::vector<std::string_view> ret;
+    size_t                        begin  = 0;
+    size_t                        parity = 0;
+    for (size_t k = 1; k < parts; ++k) {
+        parity += quotes[k - 1];
+
+        if (begin > k * segment) {
+            continue; // the previous record ran past this cut
+        }
+        size_t i       = k * segment;
+        bool   bInside = parity & 1;
+        for (; i < buffer.size(); ++i) {
+            if (buffer[i] == opt.quote) {
+                bInside = !bInside;
+            }
+            else if (buffer[i] == '\n' && !bInside) {
+                break;
+            }
+        }
+        if (i >= buffer.size()) {
+            break;
+        }
+        ret.push_back(buffer.substr(begin, i + 1 - begin));
+        begin = i + 1;
+    }
+    if (begin < buffer.size()) {
+        ret.push_back(buffer.substr(begin));
+    }
+    return ret;
+}
+
+} // namespace csv
+} // namespace ut
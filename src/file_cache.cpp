@@ -0,0 +1,380 @@
+#include "utility.cc/file_cache.h"
+
+#include <algorithm>
+#include <vector>
+
+#if __linux__
+    #include <cerrno>
+    #include <poll.h>
+    #include <sys/eventfd.h>
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#endif
+
+#include "debug.h"
+#include "utility.cc/file_utils.h"
+
+
+namespace ut
+{
+namespace file
+{
+
+content_cache::content_cache() : content_cache(options{}) {}
+
+content_cache::content_cache(options opt) : _opt(opt)
+{
+    if (!_opt.bWatch) {
+        return;
+    }
+#if __linux__
+    _inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    _wake_fd    = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_inotify_fd < 0 || _wake_fd < 0) {
+        log(), "inotify unavailable, falling back to polling mtimes";
+        if (_inotify_fd >= 0) {
+            ::close(_inotify_fd);
+        }
+        if (_wake_fd >= 0) {
+            ::close(_wake_fd);
+        }
+        _inotify_fd = _wake_fd = -1;
+    }
+#endif
+    _watcher = std::thread([this]() { watcher_loop(); });
+}
+
+content_cache::~content_cache()
+{
+    {
+        std::lock_guard lock(_stop_mutex);
+        _bStop = true;
+    }
+    _stop_cv.notify_all();
+#if __linux__
+    if (_wake_fd >= 0) {
+        uint64_t one = 1;
+        (void)!::write(_wake_fd, &one, sizeof(one));
+    }
+#endif
+    if (_watcher.joinable()) {
+        _watcher.join();
+    }
+#if __linux__
+    if (_inotify_fd >= 0) {
+        ::close(_inotify_fd);
+    }
+    if (_wake_fd >= 0) {
+        ::close(_wake_fd);
+    }
+#endif
+}
+
+content_cache &content_cache::global()
+{
+    static content_cache cache;
+    return cache;
+}
+
+std::string content_cache::key_of(const std::filesystem::path &filepath)
+{
+    // absolute() and lexically_normal() cost more than the lookup, skip them for paths that are already normal
+    const std::string s = filepath.string();
+    if (filepath.is_absolute() && s.find("/.") == std::string::npos && s.find("//") == std::string::npos &&
+        s.find('\\') == std::string::npos && s.back() != '/')
+    {
+        return s;
+    }
+
+    std::error_code ec;
+    auto            abs = std::filesystem::absolute(filepath, ec);
+    return (ec ? filepath : abs).lexically_normal().string();
+}
+
+
+content_cache::buffer content_cache::get(const std::filesystem::path &filepath)
+{
+    const std::string key = key_of(filepath);
+    {
+        std::shared_lock lock(_mutex);
+        auto             it = _entries.find(key);
+        if (it != _entries.end()) {
+            // no write to shared state unless the entry's tick is stale, hits don't bounce a cache line
+            const uint64_t now = _tick.load(std::memory_order_relaxed);
+            if (it->second->last_access.load(std::memory_order_relaxed) != now) {
+                it->second->last_access.store(now, std::memory_order_relaxed);
+            }
+            _hits.fetch_add(1, std::memory_order_relaxed);
+            return it->second->content;
+        }
+    }
+    _misses.fetch_add(1, std::memory_order_relaxed);
+
+    // read outside the lock; an invalidation meanwhile means the bytes may be stale, don't cache them
+    const uint64_t  generation = _generation.load(std::memory_order_acquire);
+    std::error_code ec;
+    auto            mtime   = std::filesystem::last_write_time(key, ec);
+    auto            content = read_all(key);
+    if (!content) {
+        return nullptr;
+    }
+    auto ret = std::make_shared<const std::string>(std::move(*content));
+
+    const std::filesystem::path path(key);
+    if (_opt.bWatch) {
+        watch_directory(path.parent_path());
+    }
+
+    std::unique_lock lock(_mutex);
+    if (_generation.load(std::memory_order_acquire) != generation) {
+        return ret;
+    }
+    auto [it, bInserted] = _entries.try_emplace(key, nullptr);
+    if (!bInserted) {
+        return it->second->content; // another reader got here first
+    }
+    it->second          = std::make_unique<entry>();
+    it->second->content = ret;
+    it->second->mtime   = mtime;
+    it->second->size    = ret->size();
+    it->second->last_access.store(_tick.fetch_add(1, std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    _bytes += ret->size();
+    evict_locked();
+    return ret;
+}
+
+void content_cache::evict_locked()
+{
+    if (_bytes <= _opt.byte_budget) {
+        return;
+    }
+    // down to 7/8 of the budget so a full cache doesn't sort on every miss
+    const size_t target = _opt.byte_budget - _opt.byte_budget / 8;
+
+    std::vector<std::pair<uint64_t, decltype(_entries)::iterator>> order;
+    order.reserve(_entries.size());
+    for (auto it = _entries.begin(); it != _entries.end(); ++it) {
+        order.emplace_back(it->second->last_access.load(std::memory_order_relaxed), it);
+    }
+    std::sort(order.begin(), order.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+
+    for (auto &[tick, it] : order) {
+        if (_bytes <= target) {
+            break;
+        }
+        _bytes -= it->second->content->size();
+        _entries.erase(it);
+        _evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void content_cache::invalidate(const std::filesystem::path &filepath)
+{
+    const std::string key = key_of(filepath);
+    std::unique_lock  lock(_mutex);
+    _generation.fetch_add(1, std::memory_order_release);
+    auto it = _entries.find(key);
+    if (it != _entries.end()) {
+        _bytes -= it->second->content->size();
+        _entries.erase(it);
+        _invalidations.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void content_cache::clear()
+{
+    std::unique_lock lock(_mutex);
+    _generation.fetch_add(1, std::memory_order_release);
+    _entries.clear();
+    _bytes = 0;
+}
+
+void content_cache::set_budget(size_t byte_budget)
+{
+    std::unique_lock lock(_mutex);
+    _opt.byte_budget = byte_budget;
+    evict_locked();
+}
+
+
+content_cache::subscription_id content_cache::subscribe(const std::filesystem::path &filepath, change_callback fn)
+{
+    subscription sub{.key = key_of(filepath), .fn = std::move(fn)};
+
+    std::error_code ec;
+    sub.mtime = std::filesystem::last_write_time(sub.key, ec);
+    sub.size  = std::filesystem::file_size(sub.key, ec);
+    if (_opt.bWatch) {
+        watch_directory(std::filesystem::path(sub.key).parent_path());
+    }
+
+    std::lock_guard lock(_subscription_mutex);
+    subscription_id id = _next_subscription++;
+    _subscriptions.emplace(id, std::move(sub));
+    return id;
+}
+
+void content_cache::unsubscribe(subscription_id id)
+{
+    std::lock_guard lock(_subscription_mutex);
+    _subscriptions.erase(id);
+}
+
+void content_cache::changed(const std::string &key)
+{
+    invalidate(key);
+
+    std::vector<change_callback> callbacks;
+    {
+        std::lock_guard lock(_subscription_mutex);
+        for (auto &[id, sub] : _subscriptions) {
+            if (sub.key == key) {
+                callbacks.push_back(sub.fn);
+            }
+        }
+    }
+    const std::filesystem::path path(key);
+    for (auto &fn : callbacks) {
+        try {
+            fn(path);
+        }
+        catch (...) {
+            log(), "file change callback threw for", key;
+        }
+    }
+}
+
+
+void content_cache::poll()
+{
+    std::vector<std::string> stale;
+    {
+        std::shared_lock lock(_mutex);
+        for (auto &[key, e] : _entries) {
+            std::error_code ec;
+            auto            mtime = std::filesystem::last_write_time(key, ec);
+            if (ec || mtime != e->mtime || std::filesystem::file_size(key, ec) != e->size) {
+                stale.push_back(key);
+            }
+        }
+    }
+    {
+        std::lock_guard lock(_subscription_mutex);
+        for (auto &[id, sub] : _subscriptions) {
+            std::error_code ec;
+            auto            mtime = std::filesystem::last_write_time(sub.key, ec);
+            auto            size  = std::filesystem::file_size(sub.key, ec);
+            if (mtime != sub.mtime || size != sub.size) {
+                sub.mtime = mtime;
+                sub.size  = size;
+                if (std::find(stale.begin(), stale.end(), sub.key) == stale.end()) {
+                    stale.push_back(sub.key);
+                }
+            }
+        }
+    }
+    for (auto &key : stale) {
+        changed(key);
+    }
+}
+
+void content_cache::watch_directory(const std::filesystem::path &dir)
+{
+#if __linux__
+    if (_inotify_fd < 0) {
+        return;
+    }
+    std::lock_guard lock(_watch_mutex);
+    // the same directory gives back the same descriptor, watches live as long as the cache
+    int wd = inotify_add_watch(_inotify_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM | IN_MODIFY);
+    if (wd < 0) {
+        log(), "inotify_add_watch failed for", dir;
+        return;
+    }
+    _watched_dirs[wd] = dir.string();
+#else
+    (void)dir;
+#endif
+}
+
+void content_cache::watcher_loop()
+{
+#if __linux__
+    if (_inotify_fd >= 0) {
+        alignas(inotify_event) char events[16 * 1024];
+        while (true) {
+            pollfd fds[2] = {{.fd = _inotify_fd, .events = POLLIN, .revents = 0}, {.fd = _wake_fd, .events = POLLIN, .revents = 0}};
+            int ready = ::poll(fds, 2, -1);
+            if (ready < 0 && errno == EINTR) {
+                continue;
+            }
+            if (ready < 0 || (fds[1].revents & POLLIN)) {
+                return;
+            }
+
+            std::vector<std::string> keys;
+            ssize_t                  n;
+            while ((n = ::read(_inotify_fd, events, sizeof(events))) > 0) {
+                std::lock_guard lock(_watch_mutex);
+                for (char *p = events; p < events + n;) {
+                    auto *ev = reinterpret_cast<inotify_event *>(p);
+                    p += sizeof(inotify_event) + ev->len;
+                    auto dir = _watched_dirs.find(ev->wd);
+                    if (ev->len == 0 || dir == _watched_dirs.end()) {
+                        continue;
+                    }
+                    std::string key = (std::filesystem::path(dir->second) / ev->name).string();
+                    if (std::find(keys.begin(), keys.end(), key) == keys.end()) {
+                        keys.push_back(std::move(key));
+                    }
+                }
+            }
+            // a burst of writes to one file becomes one notification
+            for (auto &key : keys) {
+                bool bInteresting;
+                {
+                    std::shared_lock lock(_mutex);
+                    bInteresting = _entries.contains(key);
+                }
+                if (!bInteresting) {
+                    std::lock_guard lock(_subscription_mutex);
+                    bInteresting = std::any_of(_subscriptions.begin(), _subscriptions.end(), [&](auto &kv) { return kv.second.key == key; });
+                }
+                if (bInteresting) {
+                    changed(key);
+                }
+            }
+        }
+    }
+#endif
+
+    std::unique_lock lock(_stop_mutex);
+    while (!_stop_cv.wait_for(lock, _opt.poll_interval, [this]() { return _bStop; })) {
+        lock.unlock();
+        poll();
+        lock.lock();
+    }
+}
+
+
+content_cache::stats content_cache::statistics() const
+{
+    std::shared_lock lock(_mutex);
+    return stats{
+        .hits          = _hits.load(std::memory_order_relaxed),
+        .misses        = _misses.load(std::memory_order_relaxed),
+        .evictions     = _evictions.load(std::memory_order_relaxed),
+        .invalidations = _invalidations.load(std::memory_order_relaxed),
+        .entries       = _entries.size(),
+        .bytes         = _bytes,
+    };
+}
+
+
+std::shared_ptr<const std::string> read_cached(const std::filesystem::path &filepath)
+{
+    return content_cache::global().get(filepath);
+}
+
+} // namespace file
+} // namespace ut
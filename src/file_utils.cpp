@@ -8,14 +8,32 @@
 
 
 #include "utility.cc/file_utils.h"
+#include "utility.cc/alloc_tracker.h"
+#include "utility.cc/utf.h"
 
 #include <cstddef>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <utility>
+
+#if _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
 
 #include "debug.h"
+#include "simd_utils.h"
 
 
 namespace ut
@@ -28,6 +46,7 @@ namespace file
 std::optional<std::string> read_all(const std::filesystem::path &filepath)
 {
     static constexpr size_t FILE_MAX_SIZE = 1024 * 1024 * 128; // 128 MB
+    UT_ALLOC_SCOPE("file::read_all");
 
     // Open the file
     std::ifstream f(filepath, std::ios::binary | std::ios::ate);
@@ -69,6 +88,19 @@ std::optional<std::string> read_all(const std::filesystem::path &filepath)
     return buffer;
 }
 
+std::optional<std::string> read_all(const std::filesystem::path &filepath, bool bValidateUtf8)
+{
+    auto content = read_all(filepath);
+    if (content && bValidateUtf8) {
+        size_t valid = utf::valid_prefix(*content);
+        if (valid != content->size()) {
+            log(), "File is not valid UTF-8 at byte", valid, ":", filepath;
+            return std::nullopt;
+        }
+    }
+    return content;
+}
+
 
 
 ImageInfo ImageInfo::detect(const std::filesystem::path &filepath)
@@ -144,10 +176,379 @@ ImageInfo ImageInfo::detect(const std::filesystem::path &filepath)
     return info;
 }
 
+std::optional<mapped_file> mapped_file::open(const std::filesystem::path &filepath)
+{
+    mapped_file f;
+#if _WIN32
+    HANDLE file = CreateFileW(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        log(), "Failed to open file: ", filepath;
+        return std::nullopt;
+    }
+    f._file = file;
+#else
+    f._fd = ::open(filepath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (f._fd < 0) {
+        log(), "Failed to open file: ", filepath;
+        return std::nullopt;
+    }
+#endif
+    if (!f.remap()) {
+        log(), "Failed to map file: ", filepath;
+        return std::nullopt;
+    }
+    return f;
+}
+
+mapped_file::mapped_file(mapped_file &&other) noexcept
+{
+    *this = std::move(other);
+}
+
+mapped_file &mapped_file::operator=(mapped_file &&other) noexcept
+{
+    if (this != &other) {
+        unmap();
+#if _WIN32
+        if (_file) {
+            CloseHandle(_file);
+        }
+        _file    = std::exchange(other._file, nullptr);
+        _mapping = std::exchange(other._mapping, nullptr);
+#else
+        if (_fd >= 0) {
+            ::close(_fd);
+        }
+        _fd = std::exchange(other._fd, -1);
+#endif
+        _data = std::exchange(other._data, nullptr);
+        _size = std::exchange(other._size, 0);
+    }
+    return *this;
+}
+
+mapped_file::~mapped_file()
+{
+    unmap();
+#if _WIN32
+    if (_file) {
+        CloseHandle(_file);
+    }
+#else
+    if (_fd >= 0) {
+        ::close(_fd);
+    }
+#endif
+}
+
+void mapped_file::unmap()
+{
+#if _WIN32
+    if (_data) {
+        UnmapViewOfFile(_data);
+    }
+    if (_mapping) {
+        CloseHandle(_mapping);
+        _mapping = nullptr;
+    }
+#else
+    if (_data) {
+        munmap(const_cast<char *>(_data), _size);
+    }
+#endif
+    _data = nullptr;
+    _size = 0;
+}
+
+bool mapped_file::remap()
+{
+    unmap();
+#if _WIN32
+    LARGE_INTEGER size;
+    if (!_file || !GetFileSizeEx(_file, &size)) {
+        return false;
+    }
+    if (size.QuadPart == 0) {
+        return true; // nothing to map, an empty view
+    }
+    _mapping = CreateFileMappingW(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!_mapping) {
+        return false;
+    }
+    _data = static_cast<const char *>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!_data) {
+        return false;
+    }
+    _size = static_cast<size_t>(size.QuadPart);
+#else
+    struct stat st;
+    if (_fd < 0 || fstat(_fd, &st) != 0) {
+        return false;
+    }
+    if (st.st_size == 0) {
+        return true; // mmap rejects a zero length, an empty view
+    }
+    void *p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, _fd, 0);
+    if (p == MAP_FAILED) {
+        return false;
+    }
+    madvise(p, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+    _data = static_cast<const char *>(p);
+    _size = static_cast<size_t>(st.st_size);
+#endif
+    return true;
+}
+
+
+line_index::line_index(uint32_t sample_every)
+    : _every(sample_every ? sample_every : 1)
+{
+    reset();
+}
+
+void line_index::reset()
+{
+    _samples.assign(1, sample{.offset = 0, .delta_pos = 0});
+    _deltas.clear();
+    _newlines   = 0;
+    _last_start = 0;
+    _scanned    = 0;
+}
+
+void line_index::on_newline(size_t pos)
+{
+    const uint64_t start = pos + 1;
+    const uint64_t delta = start - _last_start;
+    _last_start          = start;
+
+    if (++_newlines % _every == 0) {
+        _samples.push_back(sample{.offset = start, .delta_pos = _deltas.size()});
+        return;
+    }
+    // LEB128: 7 bits per byte, high bit set while more follow
+    uint64_t v = delta;
+    while (v >= 0x80) {
+        _deltas.push_back(static_cast<uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    _deltas.push_back(static_cast<uint8_t>(v));
+}
+
+std::optional<line_index> line_index::build(const std::filesystem::path &filepath, uint32_t sample_every)
+{
+    line_index index(sample_every);
+    if (!index.update_file(filepath)) {
+        return std::nullopt;
+    }
+    return index;
+}
+
+void line_index::update(std::string_view content)
+{
+    if (content.size() < _scanned) {
+        reset();
+    }
+
+    const char  *base = content.data();
+    size_t       i    = _scanned;
+    const size_t end  = content.size();
+    for (; i + 64 <= end; i += 64) {
+        simd::for_each_bit(simd::block64(base + i).eq('\n'), [&](size_t bit) { on_newline(i + bit); });
+    }
+    if (i < end) {
+        simd::tail_block tail(base + i, end - i);
+        simd::for_each_bit(simd::block64(tail.bytes).eq('\n') & ((uint64_t(1) << (end - i)) - 1),
+                           [&](size_t bit) { on_newline(i + bit); });
+    }
+    _scanned = end;
+}
+
+bool line_index::update_file(const std::filesystem::path &filepath)
+{
+    auto file = mapped_file::open(filepath);
+    if (!file) {
+        return false;
+    }
+    update(file->view());
+    return true;
+}
+
+size_t line_index::lines() const
+{
+    return static_cast<size_t>(_newlines + (_scanned > _last_start ? 1 : 0));
+}
+
+uint64_t line_index::start_of(size_t n) const
+{
+    const sample  &s   = _samples[n / _every];
+    uint64_t       off = s.offset;
+    const uint8_t *p   = _deltas.data() + s.delta_pos;
+    for (size_t r = n % _every; r > 0; --r) {
+        uint64_t v     = 0;
+        int      shift = 0;
+        do {
+            v |= uint64_t(*p & 0x7F) << shift;
+            shift += 7;
+        } while (*p++ & 0x80);
+        off += v;
+    }
+    return off;
+}
+
+std::optional<size_t> line_index::offset(size_t n) const
+{
+    if (n >= lines()) {
+        return std::nullopt;
+    }
+    return static_cast<size_t>(start_of(n));
+}
+
+std::optional<std::string_view> line_index::line(std::string_view content, size_t n) const
+{
+    if (n >= lines()) {
+        return std::nullopt;
+    }
+    const uint64_t begin = start_of(n);
+    const uint64_t end   = n < _newlines ? start_of(n + 1) - 1 : _scanned; // without the '\n'
+    if (end > content.size()) {
+        return std::nullopt;
+    }
+    std::string_view ret = content.substr(begin, end - begin);
+    if (!ret.empty() && ret.back() == '\r') {
+        ret.remove_suffix(1);
+    }
+    return ret;
+}
+
+
+namespace
+{
+constexpr char LINE_INDEX_MAGIC[8] = {'U', 'T', 'L', 'I', 'D', 'X', '0', '1'};
+
+template <typename T>
+void write_pod(std::ofstream &f, const T &value)
+{
+    f.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+bool read_pod(std::ifstream &f, T &value)
+{
+    return static_cast<bool>(f.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+} // namespace
+
+bool line_index::save(const std::filesystem::path &filepath) const
+{
+    std::ofstream f(filepath, std::ios::binary | std::ios::trunc);
+    if (!f.is_open()) {
+        log(), "Failed to open file: ", filepath;
+        return false;
+    }
+    // native byte order, the index is a cache next to the file it describes
+    f.write(LINE_INDEX_MAGIC, sizeof(LINE_INDEX_MAGIC));
+    write_pod(f, _every);
+    write_pod(f, _newlines);
+    write_pod(f, _last_start);
+    write_pod(f, _scanned);
+    write_pod(f, static_cast<uint64_t>(_samples.size()));
+    write_pod(f, static_cast<uint64_t>(_deltas.size()));
+    f.write(reinterpret_cast<const char *>(_samples.data()), static_cast<std::streamsize>(_samples.size() * sizeof(sample)));
+    f.write(reinterpret_cast<const char *>(_deltas.data()), static_cast<std::streamsize>(_deltas.size()));
+    if (!f) {
+        log(), "Failed to write line index: ", filepath;
+        return false;
+    }
+    return true;
+}
+
+std::optional<line_index> line_index::load(const std::filesystem::path &filepath)
+{
+    std::ifstream f(filepath, std::ios::binary);
+    if (!f.is_open()) {
+        log(), "Failed to open file: ", filepath;
+        return std::nullopt;
+    }
+
+    std::error_code ec;
+    const uint64_t  file_size = std::filesystem::file_size(filepath, ec);
+
+    char     magic[sizeof(LINE_INDEX_MAGIC)];
+    uint32_t every   = 0;
+    uint64_t samples = 0, deltas = 0;
+    line_index index;
+    if (ec || !f.read(magic, sizeof(magic)) || std::memcmp(magic, LINE_INDEX_MAGIC, sizeof(magic)) != 0 ||
+        !read_pod(f, every) || !read_pod(f, index._newlines) || !read_pod(f, index._last_start) ||
+        !read_pod(f, index._scanned) || !read_pod(f, samples) || !read_pod(f, deltas) ||
+        every == 0 || samples != index._newlines / every + 1 || samples > file_size / sizeof(sample) || deltas > file_size)
+    {
+        log(), "Not a line index: ", filepath;
+        return std::nullopt;
+    }
+
+    index._every = every;
+    index._samples.resize(samples);
+    index._deltas.resize(deltas);
+    if (!f.read(reinterpret_cast<char *>(index._samples.data()), static_cast<std::streamsize>(samples * sizeof(sample))) ||
+        !f.read(reinterpret_cast<char *>(index._deltas.data()), static_cast<std::streamsize>(deltas)))
+    {
+        log(), "Truncated line index: ", filepath;
+        return std::nullopt;
+    }
+
+    // start_of() trusts the table: every sample's varints must end exactly where the next sample's begin,
+    // and the line starts they add up to must keep increasing
+    uint64_t start = 0;
+    for (uint64_t k = 0; k < samples; ++k) {
+        const sample  &s     = index._samples[k];
+        const bool     bLast = k + 1 == samples;
+        const uint64_t end   = bLast ? deltas : index._samples[k + 1].delta_pos;
+        if (k == 0 ? s.offset != 0 || s.delta_pos != 0 : s.offset <= start || s.delta_pos > end) {
+            log(), "Corrupt line index: ", filepath;
+            return std::nullopt;
+        }
+        start = s.offset;
+
+        uint64_t       pos   = s.delta_pos;
+        const uint64_t count = bLast ? index._newlines - k * every : every - 1;
+        for (uint64_t r = 0; r < count; ++r) {
+            uint64_t v     = 0;
+            int      shift = 0;
+            uint8_t  b     = 0;
+            do {
+                if (pos >= end || shift > 63) {
+                    log(), "Corrupt line index: ", filepath;
+                    return std::nullopt;
+                }
+                b = index._deltas[pos++];
+                v |= uint64_t(b & 0x7F) << shift;
+                shift += 7;
+            } while (b & 0x80);
+            if (v == 0 || start + v < start) {
+                log(), "Corrupt line index: ", filepath;
+                return std::nullopt;
+            }
+            start += v;
+        }
+        if (pos != end) {
+            log(), "Corrupt line index: ", filepath;
+            return std::nullopt;
+        }
+    }
+    if (start != index._last_start || index._last_start > index._scanned) {
+        log(), "Corrupt line index: ", filepath;
+        return std::nullopt;
+    }
+    return index;
+}
+
+
 std::optional<size_t> get_content_hash(const std::filesystem::path &filepath)
 {
-    if (auto content = ut::file::read_all(filepath)) {
-        return ut::file::get_hash(*content);
+    // hash the mapping in place: no copy, no read_all size cap, and std::hash of a view equals that of the string
+    if (auto mapping = mapped_file::open(filepath)) {
+        return std::hash<std::string_view>{}(mapping->view());
     }
     return {};
 }
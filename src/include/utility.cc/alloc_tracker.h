@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <source_location>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "plat.h"
+
+/*
+Opt-in heap instrumentation
+
+- counting needs the global operator new/delete hooks: the library installs them when built with
+  `xmake config --utility_alloc_tracking=true` (UTILITY_ALLOC_TRACKING), or a test executable puts
+  UT_ALLOC_DEFINE_HOOKS() in one of its .cpp files
+- UT_ALLOC_SCOPE("tag") attributes what a block allocates to tag + call site, compiled out without UTILITY_ALLOC_TRACKING
+- UT_EXPECT_NO_ALLOC { ... } aborts with a log if the block allocates on this thread
+*/
+
+namespace ut
+{
+
+namespace alloc
+{
+
+struct counters
+{
+    uint64_t allocations = 0;
+    uint64_t frees       = 0;
+    uint64_t bytes       = 0; // requested by the allocations
+    int64_t  live_bytes  = 0; // allocated - freed, per thread it goes negative for memory freed by another thread
+    int64_t  peak_bytes  = 0; // highest live_bytes
+};
+
+// totals of one UT_ALLOC_SCOPE call site over all its runs, peak is the highest of one run
+struct site
+{
+    std::string tag;
+    std::string file;
+    uint32_t    line = 0;
+    uint64_t    runs = 0;
+    counters    total;
+};
+
+// true once a hooked allocation was seen, without hooks every counter stays 0
+UTILITY_CC_API bool hooked();
+
+UTILITY_CC_API counters totals();        // process wide
+UTILITY_CC_API counters thread_totals(); // this thread only, deterministic under concurrency
+
+UTILITY_CC_API std::vector<site> report();
+UTILITY_CC_API void              reset(); // clear the report and the totals
+
+/**
+ * Counts this thread's allocations between construction and destruction,
+ *  then adds them to the report under tag and call site. Scopes nest, each counts inclusively.
+ */
+class UTILITY_CC_API scope
+{
+  public:
+    explicit scope(std::string_view tag, std::source_location loc = std::source_location::current());
+    ~scope();
+
+    scope(const scope &)            = delete;
+    scope &operator=(const scope &) = delete;
+
+    // what the scope allocated so far, peak relative to its start
+    counters so_far() const;
+
+  private:
+    std::string          _tag; // owned, the caller's string may be a temporary
+    std::source_location _loc;
+    counters             _start;
+    int64_t              _outer_peak;
+};
+
+/**
+ * Fails (log + abort) when this thread allocates more than `max_allocations` before destruction
+ * Used through UT_EXPECT_NO_ALLOC / UT_EXPECT_ALLOCS.
+ */
+class UTILITY_CC_API expect_allocs
+{
+  public:
+    explicit expect_allocs(uint64_t max_allocations, std::source_location loc = std::source_location::current());
+    ~expect_allocs();
+
+    expect_allocs(const expect_allocs &)            = delete;
+    expect_allocs &operator=(const expect_allocs &) = delete;
+
+    // true on the first call only, lets the macros wrap a block in a for statement
+    bool once() { return !_bDone && (_bDone = true); }
+
+  private:
+    uint64_t             _max;
+    uint64_t             _start;
+    std::source_location _loc;
+    bool                 _bDone = false;
+};
+
+namespace detail
+{
+// what the hooks call, a 16 byte header in front of each block keeps its size for unsized delete
+UTILITY_CC_API void *allocate(size_t size, size_t align, bool bNothrow);
+UTILITY_CC_API void  deallocate(void *p) noexcept;
+} // namespace detail
+
+} // namespace alloc
+
+} // namespace ut
+
+
+#define UT_ALLOC_CONCAT_IMPL(a, b) a##b
+#define UT_ALLOC_CONCAT(a, b) UT_ALLOC_CONCAT_IMPL(a, b)
+
+#if UTILITY_ALLOC_TRACKING
+    #define UT_ALLOC_SCOPE(tag) ::ut::alloc::scope UT_ALLOC_CONCAT(ut_alloc_scope_, __LINE__)(tag)
+#else
+    #define UT_ALLOC_SCOPE(tag) ((void)0)
+#endif
+
+#define UT_EXPECT_ALLOCS(n) for (::ut::alloc::expect_allocs ut_expect_allocs_guard(n); ut_expect_allocs_guard.once();)
+#define UT_EXPECT_NO_ALLOC UT_EXPECT_ALLOCS(0)
+
+// replacement global operator new/delete routed through the tracker, in exactly one .cpp of a program
+#define UT_ALLOC_DEFINE_HOOKS()                                                                                                  \
+    void *operator new(size_t n) { return ::ut::alloc::detail::allocate(n, 0, false); }                                          \
+    void *operator new[](size_t n) { return ::ut::alloc::detail::allocate(n, 0, false); }                                        \
+    void *operator new(size_t n, const std::nothrow_t &) noexcept { return ::ut::alloc::detail::allocate(n, 0, true); }          \
+    void *operator new[](size_t n, const std::nothrow_t &) noexcept { return ::ut::alloc::detail::allocate(n, 0, true); }        \
+    void *operator new(size_t n, std::align_val_t a) { return ::ut::alloc::detail::allocate(n, size_t(a), false); }              \
+    void *operator new[](size_t n, std::align_val_t a) { return ::ut::alloc::detail::allocate(n, size_t(a), false); }            \
+    void *operator new(size_t n, std::align_val_t a, const std::nothrow_t &) noexcept                                            \
+    {                                                                                                                            \
+        return ::ut::alloc::detail::allocate(n, size_t(a), true);                                                                \
+    }                                                                                                                            \
+    void *operator new[](size_t n, std::align_val_t a, const std::nothrow_t &) noexcept                                          \
+    {                                                                                                                            \
+        return ::ut::alloc::detail::allocate(n, size_t(a), true);                                                                \
+    }                                                                                                                            \
+    void operator delete(void *p) noexcept { ::ut::alloc::detail::deallocate(p); }                                               \
+    void operator delete[](void *p) noexcept { ::ut::alloc::detail::deallocate(p); }                                             \
+    void operator delete(void *p, size_t) noexcept { ::ut::alloc::detail::deallocate(p); }                                       \
+    void operator delete[](void *p, size_t) noexcept { ::ut::alloc::detail::deallocate(p); }                                     \
+    void operator delete(void *p, std::align_val_t) noexcept { ::ut::alloc::detail::deallocate(p); }                             \
+    void operator delete[](void *p, std::align_val_t) noexcept { ::ut::alloc::detail::deallocate(p); }                           \
+    void operator delete(void *p, size_t, std::align_val_t) noexcept { ::ut::alloc::detail::deallocate(p); }                     \
+    void operator delete[](void *p, size_t, std::align_val_t) noexcept { ::ut::alloc::detail::deallocate(p); }                   \
+    void operator delete(void *p, const std::nothrow_t &) noexcept { ::ut::alloc::detail::deallocate(p); }                       \
+    void operator delete[](void *p, const std::nothrow_t &) noexcept { ::ut::alloc::detail::deallocate(p); }                     \
+    void operator delete(void *p, std::align_val_t, const std::nothrow_t &) noexcept { ::ut::alloc::detail::deallocate(p); }     \
+    void operator delete[](void *p, std::align_val_t, const std::nothrow_t &) noexcept { ::ut::alloc::detail::deallocate(p); }
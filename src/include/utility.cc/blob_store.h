@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "file_utils.h"
+#include "plat.h"
+
+namespace ut
+{
+
+/**
+ * Name of a blob: the XXH64 of its bytes plus their size. A defined hash, not std::hash:
+ * the names are persisted and must mean the same to every build reading the store.
+ * `variant` tells apart the (unlikely) different contents that share hash and size.
+ */
+struct UTILITY_CC_API blob_digest
+{
+    uint64_t hash    = 0;
+    uint64_t size    = 0;
+    uint8_t  variant = 0;
+
+    // the digest put() gives `bytes` (variant 0)
+    static blob_digest of(std::string_view bytes);
+
+    // "<16 hex digits>-<size>[-<variant>]", also the object's file name; size is below 2^56
+    std::string                       str() const;
+    static std::optional<blob_digest> parse(std::string_view text);
+
+    bool operator==(const blob_digest &) const = default;
+};
+
+/**
+ * Local content addressed store: identical bytes are kept once under <root>/objects/ab/cd/<digest>
+ *
+ * - writes go to <root>/tmp first and are renamed into place, a reader never sees a partial object
+ * - put_file() clones the source (reflink) when the filesystem can, or hard links it when allowed
+ * - contains() is a lookup in an in-memory open addressing table built when the store is opened
+ * - a digest already present is verified against the new bytes, so a hash collision gets its own variant
+ * - <root>/format records the layout and digest hash; a store without it holds names from an older build
+ *   (std::hash) and is refused, delete it to start over
+ *
+ *  ut::blob_store store(".cache/blobs");
+ *  auto digest = store.put_file("build/out.bin");
+ *  store.export_to(*digest, "dist/out.bin");
+ */
+class UTILITY_CC_API blob_store
+{
+  public:
+    struct options
+    {
+        bool bVerifyOnHit = true; // compare bytes when the digest exists, false trusts hash + size
+    };
+
+    explicit blob_store(const std::filesystem::path &root);
+    blob_store(const std::filesystem::path &root, options opt);
+
+    blob_store(const blob_store &)            = delete;
+    blob_store &operator=(const blob_store &) = delete;
+
+    // false if the directories could not be created, every call then fails
+    bool is_valid() const { return _bValid; }
+
+    std::optional<blob_digest> put(std::string_view bytes);
+
+    /**
+     * Ingest an existing file.
+     * @param bAllowHardlink link instead of copying when reflink isn't supported;
+     *        the store then shares the inode with `filepath`, which must not be modified afterwards
+     */
+    std::optional<blob_digest> put_file(const std::filesystem::path &filepath, bool bAllowHardlink = false);
+
+    bool                                 contains(const blob_digest &digest) const;
+    std::filesystem::path                path_of(const blob_digest &digest) const;
+    std::optional<file::mapped_file>     open(const blob_digest &digest) const;
+
+    /**
+     * Place a copy of the blob at `dest` (reflink, else a real copy), replacing it.
+     * @param bAllowHardlink link instead of copying when reflink isn't supported;
+     *        `dest` then shares the inode with the stored object, writing to it corrupts the blob for every user
+     *        (root ignores the read only mode)
+     */
+    bool export_to(const blob_digest &digest, const std::filesystem::path &dest, bool bAllowHardlink = false) const;
+
+    bool   remove(const blob_digest &digest);
+    size_t size() const;
+
+  private:
+    // open addressing, linear probing; slots hold the digest itself, size == empty marks a free slot
+    class index
+    {
+      public:
+        bool   contains(const blob_digest &d) const;
+        void   insert(const blob_digest &d);
+        bool   erase(const blob_digest &d);
+        size_t size() const { return _count; }
+
+      private:
+        struct slot
+        {
+            uint64_t hash;
+            uint64_t size_variant; // size << 8 | variant
+        };
+        static constexpr uint64_t empty = ~uint64_t(0);
+
+        size_t find(const blob_digest &d) const; // slot index, or npos
+        void   grow();
+
+        std::vector<slot> _slots;
+        size_t            _count = 0;
+    };
+
+    std::optional<blob_digest> store(const blob_digest &base, std::string_view bytes, const std::filesystem::path *source, bool bAllowHardlink);
+    std::filesystem::path      temp_path() const;
+    void                       load_index();
+
+    std::filesystem::path     _root;
+    options                   _opt;
+    bool                      _bValid = false;
+    mutable std::shared_mutex _mutex;
+    index                     _index;
+};
+
+} // namespace ut
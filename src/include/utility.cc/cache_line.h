@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+
+
+namespace ut
+{
+
+namespace detail
+{
+
+// fixed instead of std::hardware_destructive_interference_size, which may differ between TUs/compilers
+inline constexpr size_t cache_line_size = 64;
+
+template <typename T>
+struct alignas(cache_line_size) padded
+{
+    T value;
+};
+
+} // namespace detail
+
+} // namespace ut
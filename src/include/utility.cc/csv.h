@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "plat.h"
+
+namespace ut
+{
+
+namespace csv
+{
+
+struct options
+{
+    char   delimiter  = ',';       // '\t' for TSV
+    char   quote      = '"';       // fields starting with it may contain delimiters, newlines and "" escapes
+    size_t chunk_size = 1 << 20;   // bytes read from a file per refill
+};
+
+// the fields of one record, valid until the next call to reader::next()
+using row = std::span<const std::string_view>;
+
+/**
+ * Streaming RFC 4180 style record tokenizer
+ *
+ * - delimiters, quotes and newlines are classified 64 bytes at a time into bitmasks,
+ *   quoted regions come from a prefix xor of the quote mask
+ * - fields are views into the current chunk; only quoted fields with "" escapes are copied
+ * - a trailing '\r' (CRLF) is dropped, a last record without newline is still returned
+ *
+ *  auto r = ut::csv::reader::open("export.csv");
+ *  ut::csv::row fields;
+ *  while (r && r->next(fields)) { ... }
+ */
+class UTILITY_CC_API reader
+{
+  public:
+    // tokenize a buffer that outlives the reader, nothing is copied up front
+    explicit reader(std::string_view buffer, options opt = {});
+
+    // stream a file in opt.chunk_size pieces, nullopt (and a log) if it can't be opened
+    static std::optional<reader> open(const std::filesystem::path &filepath, options opt = {});
+
+    reader(reader &&)            = default;
+    reader &operator=(reader &&) = default;
+
+    /**
+     * Move to the next record
+     * @return false at the end of input or on a read error
+     */
+    bool next(row &out);
+
+    // records returned so far
+    size_t records() const { return _records; }
+
+  private:
+    reader(std::unique_ptr<std::ifstream> file, options opt);
+
+    void index();  // classify the next window of _data after _indexed_end into _structurals
+    bool refill(); // keep the unfinished record, append the next chunk of the file; false (nothing moved) at the end
+    std::string_view field(size_t begin, size_t end, bool bLast);
+
+    options _opt;
+
+    std::unique_ptr<std::ifstream> _file; // null for buffer input
+    std::vector<char>              _chunk; // not std::string: moving must keep the buffer _data points to
+    std::string_view               _data;  // _chunk or the caller's buffer
+    bool                           _bEof = false;
+
+    std::vector<uint32_t> _structurals; // unquoted delimiters/newlines of the last indexed window, from _window_begin
+    size_t                _structural_count = 0;
+    size_t                _next_structural  = 0;
+    size_t                _window_begin     = 0;
+    size_t                _cursor           = 0; // start of the current record
+    size_t                _indexed_end      = 0; // _data[.., _indexed_end) has been classified
+    uint64_t              _inside_mask      = 0; // all ones when _indexed_end is inside quotes
+
+    std::vector<std::string_view> _fields;
+    std::deque<std::string>       _unescaped; // owners of copied fields, reset per record
+    size_t                        _records = 0;
+};
+
+
+/**
+ * Split a buffer into up to `parts` slices that start and end at record boundaries, for parsing
+ *  each one on its own thread with a csv::reader.
+ * Quote parity at each cut comes from a parallel popcount of the quotes before it, so a newline
+ *  inside a quoted field is never taken as a boundary.
+ */
+UTILITY_CC_API std::vector<std::string_view> split_records(std::string_view buffer, size_t parts, options opt = {});
+
+} // namespace csv
+
+} // namespace ut
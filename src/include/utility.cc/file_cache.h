@@ -0,0 +1,140 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "plat.h"
+
+namespace ut
+{
+
+namespace file
+{
+
+/**
+ * Process wide cache of whole file contents, handed out as shared immutable buffers
+ *
+ * - a hit takes a shared lock only, readers never wait for each other
+ * - entries are evicted in approximate LRU order once their bytes exceed the budget
+ * - a watcher thread drops entries whose file changed on disk and calls the subscribers:
+ *   inotify on the parent directories on linux, an mtime poll elsewhere
+ * - buffers already handed out stay valid after eviction or invalidation
+ */
+class UTILITY_CC_API content_cache
+{
+  public:
+    using buffer          = std::shared_ptr<const std::string>;
+    using subscription_id = uint64_t;
+    using change_callback = std::function<void(const std::filesystem::path &)>;
+
+    struct options
+    {
+        size_t                    byte_budget   = 64 * 1024 * 1024;
+        bool                      bWatch        = true;                           // invalidate on change from a watcher thread
+        std::chrono::milliseconds poll_interval = std::chrono::milliseconds(500); // mtime fallback without inotify
+    };
+
+    struct stats
+    {
+        size_t hits          = 0;
+        size_t misses        = 0;
+        size_t evictions     = 0;
+        size_t invalidations = 0;
+        size_t entries       = 0;
+        size_t bytes         = 0;
+    };
+
+    content_cache();
+    explicit content_cache(options opt);
+    ~content_cache();
+
+    content_cache(const content_cache &)            = delete;
+    content_cache &operator=(const content_cache &) = delete;
+
+    // the cache behind FileUtils::read_cached, default options
+    static content_cache &global();
+
+    /**
+     * Contents of the file, from the cache or read and cached
+     * @return nullptr (and a log) if the file can't be read
+     */
+    buffer get(const std::filesystem::path &filepath);
+
+    void invalidate(const std::filesystem::path &filepath);
+    void clear();
+    void set_budget(size_t byte_budget);
+
+    /**
+     * Call `fn(path)` from the watcher thread after `filepath` changed on disk, whether it is cached or not
+     */
+    subscription_id subscribe(const std::filesystem::path &filepath, change_callback fn);
+    void            unsubscribe(subscription_id id);
+
+    // compare every entry with its file's mtime/size now, what the watcher thread does without inotify
+    void poll();
+
+    stats statistics() const;
+
+  private:
+    struct entry
+    {
+        buffer                          content;
+        std::atomic<uint64_t>           last_access{0};
+        std::filesystem::file_time_type mtime;
+        uintmax_t                       size = 0;
+    };
+
+    struct subscription
+    {
+        std::string                     key;
+        change_callback                 fn;
+        std::filesystem::file_time_type mtime{}; // last seen, for poll()
+        uintmax_t                       size = 0;
+    };
+
+    static std::string key_of(const std::filesystem::path &filepath);
+
+    void evict_locked(); // under the unique lock
+    void watch_directory(const std::filesystem::path &dir);
+    void watcher_loop();
+    void changed(const std::string &key); // invalidate and notify
+
+    options _opt;
+
+    mutable std::shared_mutex                               _mutex;
+    std::unordered_map<std::string, std::unique_ptr<entry>> _entries;
+    size_t                                                  _bytes = 0;
+    std::atomic<uint64_t>                                   _tick{0};
+    std::atomic<uint64_t>                                   _generation{0}; // bumped by every invalidation
+
+    std::mutex                                         _subscription_mutex;
+    std::unordered_map<subscription_id, subscription> _subscriptions;
+    subscription_id                                    _next_subscription = 1;
+
+    std::mutex                           _watch_mutex;
+    std::unordered_map<int, std::string> _watched_dirs; // inotify watch descriptor -> directory
+    int                                  _inotify_fd = -1;
+    int                                  _wake_fd    = -1;
+
+    std::mutex              _stop_mutex;
+    std::condition_variable _stop_cv;
+    bool                    _bStop = false;
+    std::thread             _watcher;
+
+    mutable std::atomic<size_t> _hits{0}, _misses{0}, _evictions{0}, _invalidations{0};
+};
+
+} // namespace file
+
+} // namespace ut
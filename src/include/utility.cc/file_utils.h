@@ -12,8 +12,13 @@
 
 
 #include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <memory>
 #include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
 
 
 #include "plat.h"
@@ -32,8 +37,20 @@ namespace file
  * @throws None
  */
 extern UTILITY_CC_API std::optional<std::string> read_all(const std::filesystem::path &filepath);
+
+/**
+ * read_all for untrusted text: with bValidateUtf8 a file that isn't valid UTF-8 (utility.cc/utf.h) is logged and rejected
+ */
+extern UTILITY_CC_API std::optional<std::string> read_all(const std::filesystem::path &filepath, bool bValidateUtf8);
 // extern UTILITY_CC_API void                       read_all(const std::filesystem::path &filepath, std::optional<std::string> &ret);
 
+/**
+ * read_all through the process wide content_cache (utility.cc/file_cache.h):
+ *  repeated reads of the same file share one buffer until it changes on disk
+ * @return nullptr if the file cannot be read
+ */
+extern UTILITY_CC_API std::shared_ptr<const std::string> read_cached(const std::filesystem::path &filepath);
+
 struct UTILITY_CC_API ImageInfo
 {
     enum class Format
@@ -65,6 +82,102 @@ struct UTILITY_CC_API ImageInfo
 
 
 
+/**
+ * Read only memory mapping of a whole file (mmap, MapViewOfFile on windows), no size limit
+ * An empty file maps to an empty view.
+ */
+class UTILITY_CC_API mapped_file
+{
+  public:
+    // nullopt (and a log) if the file can't be opened or mapped
+    static std::optional<mapped_file> open(const std::filesystem::path &filepath);
+
+    mapped_file() = default;
+    mapped_file(mapped_file &&other) noexcept;
+    mapped_file &operator=(mapped_file &&other) noexcept;
+    mapped_file(const mapped_file &)            = delete;
+    mapped_file &operator=(const mapped_file &) = delete;
+    ~mapped_file();
+
+    const char      *data() const { return _data; }
+    size_t           size() const { return _size; }
+    std::string_view view() const { return {_data, _size}; }
+
+    // map the current size again, e.g. after the file was appended to
+    bool remap();
+
+  private:
+    void unmap();
+
+    const char *_data = nullptr;
+    size_t      _size = 0;
+#if _WIN32
+    void *_file    = nullptr;
+    void *_mapping = nullptr;
+#else
+    int _fd = -1;
+#endif
+};
+
+/**
+ * Line start offsets of a text file, for jumping to line N without reading what comes before it
+ *
+ * - every `sample_every`th line start is stored absolute, the others as varint encoded line lengths,
+ *   so a lookup decodes at most sample_every - 1 varints and a typical log costs ~1-2 bytes per line
+ * - newlines are found 64 bytes at a time
+ * - update()/update_file() only scan the bytes appended since the last call, save()/load() persist the table
+ *
+ *  auto index = ut::file::line_index::build("server.log");
+ *  auto line  = index->line(file.view(), 1'000'000);
+ */
+class UTILITY_CC_API line_index
+{
+  public:
+    explicit line_index(uint32_t sample_every = 64);
+
+    // map and index a file
+    static std::optional<line_index> build(const std::filesystem::path &filepath, uint32_t sample_every = 64);
+
+    /**
+     * Index the part of `content` after the already indexed prefix.
+     * A `content` shorter than what was indexed means the file was replaced, the index starts over.
+     */
+    void update(std::string_view content);
+    bool update_file(const std::filesystem::path &filepath);
+
+    // complete lines plus an unterminated last one, if any
+    size_t lines() const;
+    size_t indexed_bytes() const { return _scanned; }
+
+    // byte offset where line n (0 based) starts
+    std::optional<size_t> offset(size_t n) const;
+    // line n of the indexed content, without its '\n' (or "\r\n")
+    std::optional<std::string_view> line(std::string_view content, size_t n) const;
+
+    bool                             save(const std::filesystem::path &filepath) const;
+    static std::optional<line_index> load(const std::filesystem::path &filepath);
+
+  private:
+    struct sample
+    {
+        uint64_t offset;    // start of line k * _every
+        uint64_t delta_pos; // where the lengths of the following lines start in _deltas
+    };
+
+    void     reset();
+    void     on_newline(size_t pos);
+    uint64_t start_of(size_t n) const; // n <= _newlines
+
+    uint32_t             _every;
+    std::vector<sample>  _samples;
+    std::vector<uint8_t> _deltas;
+    uint64_t             _newlines   = 0;
+    uint64_t             _last_start = 0; // start of the last (maybe unterminated) line
+    uint64_t             _scanned    = 0;
+};
+
+
+// get_hash of the whole file, hashed from a mapping so any size works; see tree_hash.h for a parallel, chunked digest
 extern UTILITY_CC_API std::optional<size_t> get_content_hash(const std::filesystem::path &filepath);
 extern UTILITY_CC_API std::optional<size_t> get_hash(const std::string &text);
 
@@ -77,6 +190,8 @@ wrapper for not export each function
 struct UTILITY_CC_API FileUtils
 {
     static std::optional<std::string> read_all(const std::filesystem::path &filepath) { return ::ut::file::read_all(filepath); };
+    static std::optional<std::string> read_all(const std::filesystem::path &filepath, bool bValidateUtf8) { return ::ut::file::read_all(filepath, bValidateUtf8); };
+    static std::shared_ptr<const std::string> read_cached(const std::filesystem::path &filepath) { return ::ut::file::read_cached(filepath); }
     static file::ImageInfo            detect_image(const std::filesystem::path &filepath) { return ::ut::file::ImageInfo::detect(filepath); }
     static std::optional<size_t>      get_content_hash(const std::filesystem::path &filepath) { return file::get_content_hash(filepath); }
     static std::optional<size_t>      get_hash(const std::string &text) { return file::get_hash(text); }
@@ -0,0 +1,315 @@
+#pragma once
+
+#include <algorithm>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+
+namespace ut
+{
+
+// what inline_string does when a write doesn't fit into N chars
+enum class inline_overflow
+{
+    error,    // throw std::length_error
+    truncate, // keep the first N chars
+    heap,     // move to a heap buffer, the type is no longer trivially copyable
+};
+
+namespace detail
+{
+
+template <size_t N>
+using inline_size_t = std::conditional_t<(N < 256), uint8_t, std::conditional_t<(N < 65536), uint16_t, uint32_t>>;
+
+// inline only: trivially copyable
+template <size_t N, bool bHeap>
+struct inline_string_storage
+{
+    char             inline_buf[N + 1] = {};
+    inline_size_t<N> inline_size       = 0;
+};
+
+// with heap overflow, copies have to duplicate the heap buffer
+template <size_t N>
+struct inline_string_storage<N, true>
+{
+    char             inline_buf[N + 1] = {};
+    inline_size_t<N> inline_size       = 0;
+
+    char  *heap          = nullptr; // non null while the content lives on the heap
+    size_t heap_size     = 0;
+    size_t heap_capacity = 0;
+
+    constexpr inline_string_storage() = default;
+    constexpr inline_string_storage(const inline_string_storage &other) { copy_from(other); }
+    constexpr inline_string_storage(inline_string_storage &&other) noexcept { steal(other); }
+    constexpr inline_string_storage &operator=(const inline_string_storage &other)
+    {
+        if (this != &other) {
+            release();
+            copy_from(other);
+        }
+        return *this;
+    }
+    constexpr inline_string_storage &operator=(inline_string_storage &&other) noexcept
+    {
+        if (this != &other) {
+            release();
+            steal(other);
+        }
+        return *this;
+    }
+    constexpr ~inline_string_storage() { release(); }
+
+  private:
+    constexpr void copy_from(const inline_string_storage &other)
+    {
+        std::copy_n(other.inline_buf, N + 1, inline_buf);
+        inline_size = other.inline_size;
+        if (other.heap) {
+            heap          = new char[other.heap_size + 1];
+            heap_size     = other.heap_size;
+            heap_capacity = other.heap_size;
+            std::copy_n(other.heap, other.heap_size + 1, heap);
+        }
+    }
+
+    constexpr void steal(inline_string_storage &other)
+    {
+        std::copy_n(other.inline_buf, N + 1, inline_buf);
+        inline_size   = other.inline_size;
+        heap          = other.heap;
+        heap_size     = other.heap_size;
+        heap_capacity = other.heap_capacity;
+
+        other.heap          = nullptr;
+        other.inline_size   = 0;
+        other.inline_buf[0] = '\0';
+    }
+
+    constexpr void release()
+    {
+        delete[] heap;
+        heap = nullptr;
+    }
+};
+
+} // namespace detail
+
+
+/**
+ * String with a fixed inline capacity of N chars, for short keys and tokens
+ *
+ * - no allocation and no pointer chasing while the content fits
+ * - trivially copyable unless Overflow is inline_overflow::heap
+ * - always null terminated, converts to std::string_view
+ */
+template <size_t N, inline_overflow Overflow = inline_overflow::error>
+class inline_string : private detail::inline_string_storage<N, Overflow == inline_overflow::heap>
+{
+    static_assert(N > 0);
+
+    static constexpr bool bHeap = Overflow == inline_overflow::heap;
+
+  public:
+    static constexpr size_t inline_capacity = N;
+
+    constexpr inline_string() = default;
+    constexpr inline_string(std::string_view sv) { assign(sv); }
+    constexpr inline_string(const char *s) { assign(std::string_view(s)); }
+    constexpr inline_string(const std::string &s) { assign(std::string_view(s)); }
+
+    constexpr inline_string &operator=(std::string_view sv)
+    {
+        assign(sv);
+        return *this;
+    }
+
+
+    constexpr size_t size() const
+    {
+        if constexpr (bHeap) {
+            if (this->heap) {
+                return this->heap_size;
+            }
+        }
+        return this->inline_size;
+    }
+    constexpr size_t length() const { return size(); }
+    constexpr bool   empty() const { return size() == 0; }
+
+    constexpr size_t capacity() const
+    {
+        if constexpr (bHeap) {
+            if (this->heap) {
+                return this->heap_capacity;
+            }
+        }
+        return N;
+    }
+
+    // false as long as the content lives in the inline buffer
+    constexpr bool on_heap() const
+    {
+        if constexpr (bHeap) {
+            return this->heap != nullptr;
+        }
+        return false;
+    }
+
+    constexpr char *data()
+    {
+        if constexpr (bHeap) {
+            if (this->heap) {
+                return this->heap;
+            }
+        }
+        return this->inline_buf;
+    }
+    constexpr const char *data() const { return const_cast<inline_string *>(this)->data(); }
+    constexpr const char *c_str() const { return data(); }
+
+    constexpr std::string_view view() const { return {data(), size()}; }
+    constexpr operator std::string_view() const { return view(); }
+    std::string                str() const { return std::string(view()); }
+
+    constexpr char       &operator[](size_t i) { return data()[i]; }
+    constexpr const char &operator[](size_t i) const { return data()[i]; }
+
+    constexpr char       *begin() { return data(); }
+    constexpr char       *end() { return data() + size(); }
+    constexpr const char *begin() const { return data(); }
+    constexpr const char *end() const { return data() + size(); }
+
+
+    constexpr void clear() { set_size(0); }
+
+    constexpr void assign(std::string_view sv)
+    {
+        // a view of our own chars: shift them to the front, clear() would wipe them first
+        if (offset_of(sv) != npos_offset) {
+            std::copy(sv.begin(), sv.end(), data());
+            set_size(sv.size());
+            return;
+        }
+        clear();
+        append(sv);
+    }
+
+    constexpr inline_string &append(std::string_view sv)
+    {
+        size_t n = size();
+        // resize() may move our chars to a new heap buffer, a view of them has to follow
+        const size_t self = offset_of(sv);
+        resize(n + sv.size());
+        const char *src = self == npos_offset ? sv.data() : data() + self;
+        // resize() may have truncated
+        std::copy_n(src, std::min(sv.size(), size() - n), data() + n);
+        return *this;
+    }
+
+    constexpr void push_back(char c) { append(std::string_view(&c, 1)); }
+
+    constexpr inline_string &operator+=(std::string_view sv) { return append(sv); }
+    constexpr inline_string &operator+=(char c)
+    {
+        push_back(c);
+        return *this;
+    }
+
+    /**
+     * Grow or shrink to n chars, new chars are set to c.
+     * Beyond capacity: throws std::length_error / truncates / moves to the heap, depending on Overflow
+     */
+    constexpr void resize(size_t n, char c = '\0')
+    {
+        size_t old = size();
+        if (n > capacity()) {
+            if constexpr (Overflow == inline_overflow::error) {
+                throw std::length_error("ut::inline_string capacity exceeded");
+            }
+            else if constexpr (Overflow == inline_overflow::truncate) {
+                n = N;
+            }
+            else {
+                grow(n);
+            }
+        }
+        if (n > old) {
+            std::fill(data() + old, data() + n, c);
+        }
+        set_size(n);
+    }
+
+
+    // also covers inline_string on both sides, through the string_view conversion
+    friend constexpr bool operator==(const inline_string &a, std::string_view b) { return a.view() == b; }
+    friend constexpr auto operator<=>(const inline_string &a, std::string_view b) { return a.view() <=> b; }
+
+    friend std::ostream &operator<<(std::ostream &os, const inline_string &s) { return os << s.view(); }
+
+  private:
+    static constexpr size_t npos_offset = static_cast<size_t>(-1);
+
+    // where sv starts inside our buffer, npos_offset if it points elsewhere
+    constexpr size_t offset_of(std::string_view sv) const
+    {
+        const char *p = data();
+        if (std::is_constant_evaluated()) {
+            // unrelated pointers can't be ordered at compile time, equality is fine
+            for (size_t i = 0; i <= capacity(); ++i) {
+                if (sv.data() == p + i) {
+                    return i;
+                }
+            }
+            return npos_offset;
+        }
+        const bool bInside = std::less_equal<const char *>{}(p, sv.data()) && std::less<const char *>{}(sv.data(), p + capacity() + 1);
+        return bInside ? static_cast<size_t>(sv.data() - p) : npos_offset;
+    }
+
+    constexpr void set_size(size_t n)
+    {
+        if constexpr (bHeap) {
+            if (this->heap) {
+                this->heap_size = n;
+                this->heap[n]   = '\0';
+                return;
+            }
+        }
+        this->inline_size   = static_cast<detail::inline_size_t<N>>(n);
+        this->inline_buf[n] = '\0';
+    }
+
+    // heap variant only
+    constexpr void grow(size_t n)
+    {
+        if constexpr (bHeap) {
+            size_t cap  = std::max(n, capacity() * 2);
+            char  *next = new char[cap + 1];
+            size_t old  = size();
+            std::copy_n(data(), old + 1, next);
+            delete[] this->heap;
+            this->heap          = next;
+            this->heap_size     = old;
+            this->heap_capacity = cap;
+        }
+    }
+};
+
+} // namespace ut
+
+
+template <size_t N, ut::inline_overflow Overflow>
+struct std::hash<ut::inline_string<N, Overflow>>
+{
+    size_t operator()(const ut::inline_string<N, Overflow> &s) const noexcept { return std::hash<std::string_view>{}(s.view()); }
+};
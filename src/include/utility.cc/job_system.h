@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "plat.h"
+
+
+namespace ut
+{
+
+namespace detail
+{
+struct job;
+} // namespace detail
+
+
+/**
+ * Reference counted handle of a submitted job, keeps the job object alive for wait()/done()
+ */
+class UTILITY_CC_API job_handle
+{
+    detail::job *_job = nullptr;
+
+    friend class job_system;
+    explicit job_handle(detail::job *j); // adopts one reference
+
+  public:
+    job_handle() = default;
+    job_handle(const job_handle &other);
+    job_handle(job_handle &&other) noexcept : _job(other._job) { other._job = nullptr; }
+    job_handle &operator=(job_handle other) noexcept
+    {
+        std::swap(_job, other._job);
+        return *this;
+    }
+    ~job_handle();
+
+    bool valid() const { return _job != nullptr; }
+    bool done() const;
+};
+
+
+/**
+ * Work stealing scheduler
+ *
+ * - every worker owns a Chase-Lev deque: it pushes/pops at the bottom, idle workers steal from the top
+ * - threads that are not workers submit through a shared injection queue
+ * - a job may depend on other jobs, it is scheduled when the last of them finished (continuations)
+ * - wait() runs other jobs while the awaited one is not done, so waiting inside a job never dead locks
+ * - job objects are recycled through per thread free lists instead of new/delete per submit
+ */
+class UTILITY_CC_API job_system
+{
+  public:
+    struct stats
+    {
+        uint64_t executed      = 0; // jobs run; statistics() includes those run by waiting threads that aren't workers
+        uint64_t steals        = 0; // jobs taken from another worker's deque
+        uint64_t failed_steals = 0; // steal attempts that found nothing or lost the race
+        uint64_t idle_ns       = 0; // time spent looking for work / sleeping
+    };
+
+    explicit job_system(unsigned worker_count);
+    ~job_system(); // shutdown()
+
+    job_system(const job_system &)            = delete;
+    job_system &operator=(const job_system &) = delete;
+
+    /**
+     * The process wide scheduler, created on first use with hardware_concurrency() - 1 workers
+     */
+    static job_system &global();
+
+    // workers + the calling thread, which helps while it waits
+    unsigned concurrency() const { return static_cast<unsigned>(_workers.size()) + 1; }
+
+    /**
+     * Schedule fn, it runs once every job in `dependencies` finished.
+     * An exception thrown by fn is kept and rethrown by wait().
+     * @throws std::runtime_error after shutdown()
+     */
+    job_handle submit(std::function<void()> fn, std::span<const job_handle> dependencies = {});
+    job_handle submit(std::function<void()> fn, std::initializer_list<job_handle> dependencies)
+    {
+        return submit(std::move(fn), std::span<const job_handle>(dependencies.begin(), dependencies.size()));
+    }
+
+    // continuation of a single job
+    job_handle then(const job_handle &job, std::function<void()> fn) { return submit(std::move(fn), {job}); }
+
+    /**
+     * Block until the job finished, running other jobs meanwhile.
+     * @throws the exception of the awaited job, if any
+     */
+    void wait(const job_handle &job);
+
+    /**
+     * Run task(i) for every i in [0, count) on up to `max_threads` threads (caller included, 0 = all)
+     *  and wait for all of them. Used by the ut::parallel_* algorithms.
+     * @throws the first exception thrown by a task
+     */
+    void parallel(size_t count, const std::function<void(size_t)> &task, unsigned max_threads = 0);
+
+    /**
+     * Wait for every submitted job (helping), then stop and join the workers.
+     * Jobs may keep submitting continuations while draining. Safe to call more than once.
+     */
+    void shutdown();
+
+    stats              statistics() const; // summed over the workers, plus the jobs waiting threads ran
+    std::vector<stats> worker_statistics() const;
+
+  private:
+    struct worker;
+    struct shared_state;
+
+    void         schedule(detail::job *j);
+    void         finish(detail::job *j);
+    void         execute(detail::job *j);
+    detail::job *find_job(worker *self);
+    template <typename Pred>
+    void idle_wait(Pred &&pred);
+
+    shared_state            *_state = nullptr;
+    std::vector<worker *>    _worker_data;
+    std::vector<std::thread> _workers;
+};
+
+} // namespace ut
@@ -0,0 +1,335 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+
+#include "cache_line.h"
+
+
+namespace ut
+{
+
+enum class cache_eviction
+{
+    lru,   // exact recency per shard, a hit moves its entry to the front under the shard's exclusive lock
+    clock, // a hit only sets a flag under the shared lock, eviction gives flagged entries a second chance
+};
+
+/**
+ * Thread safe memoization cache, split by key hash into shards that lock and evict independently
+ *
+ * - capacity is a total cost, 1 per entry unless options::cost prices entries (e.g. in bytes);
+ *   every shard gets an equal part of it
+ * - get_or_compute(): concurrent misses on one key run compute once, the others wait for its result or exception
+ * - values are returned by copy, keep big ones behind a std::shared_ptr<const T>
+ * - composite keys need a Hash, ut::hashCombined (utility.cc/hash.h) builds one from the members
+ *
+ *  ut::lru_cache<size_t, std::shared_ptr<const config>> configs({.capacity = 256});
+ *  auto cfg = configs.get_or_compute(*ut::file::get_content_hash(path), [&]() { return parse_config(path); });
+ */
+template <typename K, typename V, typename Hash = std::hash<K>, typename KeyEqual = std::equal_to<K>>
+class lru_cache
+{
+  public:
+    struct options
+    {
+        size_t                                      capacity = 1024;    // total cost
+        size_t                                      shards   = 16;      // rounded up to a power of two, fewer if capacity is smaller
+        cache_eviction                              policy   = cache_eviction::lru;
+        std::function<size_t(const K &, const V &)> cost     = nullptr; // empty: every entry costs 1
+    };
+
+    struct stats
+    {
+        size_t hits      = 0;
+        size_t misses    = 0;
+        size_t evictions = 0;
+        size_t coalesced = 0; // get_or_compute calls that waited for another thread's compute
+        size_t entries   = 0;
+        size_t cost      = 0;
+    };
+
+    lru_cache() : lru_cache(options{}) {}
+    explicit lru_cache(options opt) : _opt(std::move(opt))
+    {
+        size_t count = std::bit_ceil(std::max<size_t>(_opt.shards, 1));
+        while (count > 1 && count > _opt.capacity) {
+            count /= 2;
+        }
+        _mask           = count - 1;
+        _shard_capacity = std::max<size_t>(1, (_opt.capacity + count - 1) / count);
+        _shards         = std::make_unique<shard[]>(count);
+    }
+
+    lru_cache(const lru_cache &)            = delete;
+    lru_cache &operator=(const lru_cache &) = delete;
+
+    std::optional<V> get(const K &key)
+    {
+        shard &s   = shard_of(key);
+        auto   ret = find(s, key);
+        (ret ? s.hits : s.misses).fetch_add(1, std::memory_order_relaxed);
+        return ret;
+    }
+
+    // whether key is cached, neither counted nor treated as a use
+    bool contains(const K &key) const
+    {
+        const shard      &s = shard_of(key);
+        std::shared_lock lock(s.mutex);
+        return s.index.contains(key);
+    }
+
+    // insert or replace
+    void put(const K &key, V value)
+    {
+        shard       &s    = shard_of(key);
+        const size_t cost = cost_of(key, value);
+        std::lock_guard lock(s.mutex);
+        insert_locked(s, key, std::move(value), cost);
+    }
+
+    /**
+     * The cached value, or compute() (called without any lock held) cached and returned.
+     * If another thread is already computing this key, waits for and returns its result instead.
+     * An exception from compute() reaches every waiting caller and nothing is cached.
+     * compute() must not ask this cache for the same key.
+     */
+    template <typename Fn>
+    V get_or_compute(const K &key, Fn &&compute)
+    {
+        shard &s = shard_of(key);
+        if (auto hit = find(s, key)) {
+            s.hits.fetch_add(1, std::memory_order_relaxed);
+            return *std::move(hit);
+        }
+
+        std::promise<V> promise;
+        {
+            std::unique_lock lock(s.mutex);
+            // filled or claimed since the lookup above
+            if (auto it = s.index.find(key); it != s.index.end()) {
+                touch_locked(s, it->second);
+                s.hits.fetch_add(1, std::memory_order_relaxed);
+                return it->second->value;
+            }
+            if (auto it = s.pending.find(key); it != s.pending.end()) {
+                std::shared_future<V> result = it->second;
+                lock.unlock();
+                s.coalesced.fetch_add(1, std::memory_order_relaxed);
+                return result.get();
+            }
+            s.pending.emplace(key, promise.get_future().share());
+            s.misses.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        try {
+            V            value = std::invoke(std::forward<Fn>(compute));
+            const size_t cost  = cost_of(key, value);
+            {
+                std::lock_guard lock(s.mutex);
+                insert_locked(s, key, value, cost);
+                s.pending.erase(key);
+            }
+            promise.set_value(value);
+            return value;
+        }
+        catch (...) {
+            {
+                std::lock_guard lock(s.mutex);
+                s.pending.erase(key);
+            }
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+    }
+
+    bool erase(const K &key)
+    {
+        shard          &s = shard_of(key);
+        std::lock_guard lock(s.mutex);
+        auto            it = s.index.find(key);
+        if (it == s.index.end()) {
+            return false;
+        }
+        remove_locked(s, it->second);
+        return true;
+    }
+
+    // drops every entry, computes in flight still finish and insert their result
+    void clear()
+    {
+        for (size_t i = 0; i <= _mask; ++i) {
+            shard          &s = _shards[i];
+            std::lock_guard lock(s.mutex);
+            s.index.clear();
+            s.entries.clear();
+            s.hand = s.entries.end();
+            s.cost = 0;
+        }
+    }
+
+    size_t capacity() const { return _shard_capacity * (_mask + 1); }
+    size_t shard_count() const { return _mask + 1; }
+
+    stats statistics() const
+    {
+        stats ret;
+        for (size_t i = 0; i <= _mask; ++i) {
+            const shard &s = _shards[i];
+            ret.hits += s.hits.load(std::memory_order_relaxed);
+            ret.misses += s.misses.load(std::memory_order_relaxed);
+            ret.evictions += s.evictions.load(std::memory_order_relaxed);
+            ret.coalesced += s.coalesced.load(std::memory_order_relaxed);
+
+            std::shared_lock lock(s.mutex);
+            ret.entries += s.index.size();
+            ret.cost += s.cost;
+        }
+        return ret;
+    }
+
+  private:
+    struct node
+    {
+        K                 key;
+        V                 value;
+        size_t            cost;
+        std::atomic<bool> bReferenced{false}; // clock only, set by hits under the shared lock
+
+        node(const K &k, V v, size_t c) : key(k), value(std::move(v)), cost(c) {}
+    };
+    using list_type = std::list<node>;
+    using iterator  = typename list_type::iterator;
+
+    // own cache line each, the counters of one shard don't slow down hits on another
+    struct alignas(detail::cache_line_size) shard
+    {
+        mutable std::shared_mutex                                    mutex;
+        list_type                                                    entries; // lru: most recent first, clock: the ring `hand` sweeps
+        iterator                                                     hand = entries.end();
+        std::unordered_map<K, iterator, Hash, KeyEqual>              index;
+        std::unordered_map<K, std::shared_future<V>, Hash, KeyEqual> pending; // get_or_compute in flight
+        size_t                                                       cost = 0;
+        std::atomic<size_t>                                          hits{0}, misses{0}, evictions{0}, coalesced{0};
+    };
+
+    shard &shard_of(const K &key) const
+    {
+        // fibonacci hashing: the top bits of the product pick the shard, keys within one still differ in the low bits
+        const uint64_t h = static_cast<uint64_t>(_hash(key)) * 0x9E3779B97F4A7C15ull;
+        return _shards[static_cast<size_t>(h >> 32) & _mask];
+    }
+
+    size_t cost_of(const K &key, const V &value) const { return _opt.cost ? _opt.cost(key, value) : 1; }
+
+    std::optional<V> find(shard &s, const K &key)
+    {
+        if (_opt.policy == cache_eviction::clock) {
+            std::shared_lock lock(s.mutex);
+            auto             it = s.index.find(key);
+            if (it == s.index.end()) {
+                return std::nullopt;
+            }
+            it->second->bReferenced.store(true, std::memory_order_relaxed);
+            return it->second->value;
+        }
+        std::lock_guard lock(s.mutex);
+        auto            it = s.index.find(key);
+        if (it == s.index.end()) {
+            return std::nullopt;
+        }
+        touch_locked(s, it->second);
+        return it->second->value;
+    }
+
+    void touch_locked(shard &s, iterator it)
+    {
+        if (_opt.policy == cache_eviction::clock) {
+            it->bReferenced.store(true, std::memory_order_relaxed);
+        }
+        else if (it != s.entries.begin()) {
+            s.entries.splice(s.entries.begin(), s.entries, it);
+        }
+    }
+
+    void insert_locked(shard &s, const K &key, V value, size_t cost)
+    {
+        auto it = s.index.find(key);
+        if (cost > _shard_capacity) {
+            // would evict everything else and then itself, not cached at all (nor its previous value)
+            if (it != s.index.end()) {
+                remove_locked(s, it->second);
+            }
+            return;
+        }
+        if (it != s.index.end()) {
+            s.cost             = s.cost - it->second->cost + cost;
+            it->second->value = std::move(value);
+            it->second->cost  = cost;
+            touch_locked(s, it->second);
+        }
+        else {
+            // clock: just behind the hand, the last entry the next sweep looks at
+            iterator pos = _opt.policy == cache_eviction::clock ? s.entries.emplace(s.hand, key, std::move(value), cost)
+                                                                : s.entries.emplace(s.entries.begin(), key, std::move(value), cost);
+            s.index.emplace(key, pos);
+            s.cost += cost;
+        }
+        evict_locked(s);
+    }
+
+    // back to the shard's budget
+    void evict_locked(shard &s)
+    {
+        while (s.cost > _shard_capacity && !s.entries.empty()) {
+            iterator victim;
+            if (_opt.policy == cache_eviction::clock) {
+                if (s.hand == s.entries.end()) {
+                    s.hand = s.entries.begin();
+                }
+                if (s.hand->bReferenced.exchange(false, std::memory_order_relaxed)) {
+                    ++s.hand;
+                    continue;
+                }
+                victim = s.hand;
+            }
+            else {
+                victim = std::prev(s.entries.end());
+            }
+            remove_locked(s, victim);
+            s.evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void remove_locked(shard &s, iterator it)
+    {
+        if (s.hand == it) {
+            ++s.hand;
+        }
+        s.cost -= it->cost;
+        s.index.erase(it->key);
+        s.entries.erase(it);
+    }
+
+    options                  _opt;
+    Hash                     _hash;
+    std::unique_ptr<shard[]> _shards;
+    size_t                   _mask           = 0;
+    size_t                   _shard_capacity = 1;
+};
+
+} // namespace ut
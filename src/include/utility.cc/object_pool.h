@@ -0,0 +1,4 @@
+
+#pragma once
+
+#include "../../object_pool.h"
\ No newline at end of file
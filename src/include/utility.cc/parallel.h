@@ -0,0 +1,223 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "cache_line.h"
+#include "job_system.h"
+#include "ranges.h"
+
+
+namespace ut
+{
+
+struct parallel_options
+{
+    size_t      grain       = 0;       // min elements per chunk, 0 = pick one from the range size
+    unsigned    max_threads = 0;       // 0 = every worker + the caller
+    job_system *scheduler   = nullptr; // nullptr = job_system::global()
+};
+
+
+namespace detail
+{
+
+// element access for random access ranges
+template <typename Range>
+struct parallel_access
+{
+    Range &range;
+
+    size_t size() const { return static_cast<size_t>(std::distance(range.begin(), range.end())); }
+
+    decltype(auto) operator[](size_t i) const { return range.begin()[static_cast<std::ptrdiff_t>(i)]; }
+
+    using element_type = std::remove_reference_t<decltype(*std::declval<Range &>().begin())>;
+};
+
+// `range | ut::enumerate`, every element still sees its index
+template <typename Range>
+struct parallel_access<enumerate_range<Range>>
+{
+    enumerate_range<Range> &range;
+
+    size_t size() const { return static_cast<size_t>(std::distance(range.m_range.begin(), range.m_range.end())); }
+
+    auto operator[](size_t i) const
+    {
+        using T = std::remove_reference_t<decltype(*range.m_range.begin())>;
+        return indexed_value<T>{i, range.m_range.begin()[static_cast<std::ptrdiff_t>(i)]};
+    }
+
+    using element_type = std::remove_reference_t<decltype(*std::declval<Range &>().begin())>;
+};
+
+template <typename Range>
+parallel_access(Range &) -> parallel_access<Range>;
+
+/**
+ * Chunk size in elements: at least `grain`, a multiple of the elements per cache line,
+ *  so neighbouring chunks never write into the same line (given an aligned base)
+ */
+template <typename Element>
+size_t chunk_size(size_t count, const parallel_options &opt, unsigned threads)
+{
+    constexpr size_t per_line = std::max<size_t>(1, cache_line_size / std::max<size_t>(1, sizeof(Element)));
+
+    size_t grain = opt.grain;
+    if (grain == 0) {
+        // ~4 chunks per thread keeps the load balanced without too much scheduling
+        grain = std::max<size_t>(1, count / (static_cast<size_t>(threads) * 4));
+    }
+    return (grain + per_line - 1) / per_line * per_line;
+}
+
+} // namespace detail
+
+
+/**
+ * Call fn(element) for every element of a random access range, split into chunks over the job system.
+ * `range | ut::enumerate` is accepted too, fn then receives {index, value}.
+ */
+template <typename Range, typename Fn>
+void parallel_for(Range &&range, Fn &&fn, parallel_options opt = {})
+{
+    detail::parallel_access access{range};
+    using element_type = typename decltype(access)::element_type;
+
+    job_system  &jobs  = opt.scheduler ? *opt.scheduler : job_system::global();
+    const size_t count = access.size();
+    if (count == 0) {
+        return;
+    }
+
+    unsigned     threads = opt.max_threads ? std::min(opt.max_threads, jobs.concurrency()) : jobs.concurrency();
+    const size_t chunk   = detail::chunk_size<element_type>(count, opt, threads);
+    const size_t chunks  = (count + chunk - 1) / chunk;
+
+    jobs.parallel(
+        chunks,
+        [&](size_t c) {
+            const size_t end = std::min(count, (c + 1) * chunk);
+            for (size_t i = c * chunk; i < end; ++i) {
+                fn(access[i]);
+            }
+        },
+        threads);
+}
+
+/**
+ * Index space overload: fn(i) for every i in [first, last)
+ */
+template <typename Fn>
+void parallel_for(size_t first, size_t last, Fn &&fn, parallel_options opt = {})
+{
+    if (last <= first) {
+        return;
+    }
+
+    job_system  &jobs    = opt.scheduler ? *opt.scheduler : job_system::global();
+    const size_t count   = last - first;
+    unsigned     threads = opt.max_threads ? std::min(opt.max_threads, jobs.concurrency()) : jobs.concurrency();
+    const size_t chunk   = detail::chunk_size<char>(count, opt, threads);
+    const size_t chunks  = (count + chunk - 1) / chunk;
+
+    jobs.parallel(
+        chunks,
+        [&](size_t c) {
+            const size_t end = first + std::min(count, (c + 1) * chunk);
+            for (size_t i = first + c * chunk; i < end; ++i) {
+                fn(i);
+            }
+        },
+        threads);
+}
+
+/**
+ * out[i] = fn(in[i]), `out` must be a random access range at least as large as `in`
+ */
+template <typename InRange, typename OutRange, typename Fn>
+void parallel_transform(InRange &&in, OutRange &&out, Fn &&fn, parallel_options opt = {})
+{
+    detail::parallel_access src{in};
+    detail::parallel_access dst{out};
+    using element_type = typename decltype(dst)::element_type;
+
+    job_system  &jobs  = opt.scheduler ? *opt.scheduler : job_system::global();
+    const size_t count = std::min(src.size(), dst.size());
+    if (count == 0) {
+        return;
+    }
+
+    // chunk by the destination type, it's the side that gets written
+    unsigned     threads = opt.max_threads ? std::min(opt.max_threads, jobs.concurrency()) : jobs.concurrency();
+    const size_t chunk   = detail::chunk_size<element_type>(count, opt, threads);
+    const size_t chunks  = (count + chunk - 1) / chunk;
+
+    jobs.parallel(
+        chunks,
+        [&](size_t c) {
+            const size_t end = std::min(count, (c + 1) * chunk);
+            for (size_t i = c * chunk; i < end; ++i) {
+                dst[i] = fn(src[i]);
+            }
+        },
+        threads);
+}
+
+/**
+ * Reduce map(element) with an associative `combine`, starting from `init`.
+ * Partial results are combined in chunk order, so a non commutative combine still gives a stable result.
+ */
+template <typename Range, typename T, typename Map, typename Combine>
+    requires(!std::is_same_v<std::decay_t<Combine>, parallel_options>)
+T parallel_reduce(Range &&range, T init, Map &&map, Combine &&combine, parallel_options opt = {})
+{
+    detail::parallel_access access{range};
+    using element_type = typename decltype(access)::element_type;
+
+    job_system  &jobs  = opt.scheduler ? *opt.scheduler : job_system::global();
+    const size_t count = access.size();
+    if (count == 0) {
+        return init;
+    }
+
+    unsigned     threads = opt.max_threads ? std::min(opt.max_threads, jobs.concurrency()) : jobs.concurrency();
+    const size_t chunk   = detail::chunk_size<element_type>(count, opt, threads);
+    const size_t chunks  = (count + chunk - 1) / chunk;
+
+    // one padded slot per chunk, partial sums must not share cache lines
+    std::vector<detail::padded<T>> partial(chunks);
+
+    jobs.parallel(
+        chunks,
+        [&](size_t c) {
+            const size_t begin = c * chunk;
+            const size_t end   = std::min(count, begin + chunk);
+
+            T acc = map(access[begin]);
+            for (size_t i = begin + 1; i < end; ++i) {
+                acc = combine(std::move(acc), map(access[i]));
+            }
+            partial[c].value = std::move(acc);
+        },
+        threads);
+
+    for (auto &p : partial) {
+        init = combine(std::move(init), std::move(p.value));
+    }
+    return init;
+}
+
+template <typename Range, typename T, typename Combine>
+T parallel_reduce(Range &&range, T init, Combine &&combine, parallel_options opt = {})
+{
+    return parallel_reduce(
+        std::forward<Range>(range), std::move(init), [](const auto &v) -> T { return v; }, std::forward<Combine>(combine), opt);
+}
+
+} // namespace ut
@@ -0,0 +1,474 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "cache_line.h"
+
+
+namespace ut
+{
+
+namespace detail
+{
+
+// sleeping side of the blocking queue operations, on top of std::atomic::wait
+struct alignas(cache_line_size) queue_waiter
+{
+    std::atomic<uint32_t> epoch{0};
+    std::atomic<uint32_t> sleepers{0};
+
+    // after publishing: the rmw orders the publish before the sleepers check, nobody asleep = no syscall
+    void notify(bool bAll)
+    {
+        epoch.fetch_add(1, std::memory_order_seq_cst);
+        if (sleepers.load(std::memory_order_seq_cst)) {
+            bAll ? epoch.notify_all() : epoch.notify_one();
+        }
+    }
+
+    // call attempt() until it succeeds, sleeping while nothing was published since the last failure
+    template <typename Fn>
+    auto wait_for(Fn &&attempt)
+    {
+        while (true) {
+            if (auto r = attempt()) {
+                return r;
+            }
+            const uint32_t seen = epoch.load(std::memory_order_seq_cst);
+            sleepers.fetch_add(1, std::memory_order_seq_cst);
+            auto r = attempt();
+            if (!r) {
+                epoch.wait(seen, std::memory_order_seq_cst);
+            }
+            sleepers.fetch_sub(1, std::memory_order_relaxed);
+            if (r) {
+                return r;
+            }
+        }
+    }
+};
+
+struct no_waiter
+{
+    void notify(bool) {}
+};
+
+template <typename T>
+struct alignas(T) queue_storage
+{
+    unsigned char bytes[sizeof(T)];
+
+    T *get() { return std::launder(reinterpret_cast<T *>(bytes)); }
+};
+
+inline size_t queue_capacity(size_t capacity) { return std::bit_ceil(std::max<size_t>(capacity, 2)); }
+
+} // namespace detail
+
+
+/**
+ * Bounded single producer / single consumer ring buffer, wait-free: no operation loops or retries
+ *
+ * - one thread pushes and one thread pops, the indices and each side's cached copy of the other index
+ *   live on separate cache lines, so the fast path touches no line the other side writes
+ * - try_push_batch()/try_pop_batch() move up to n elements with one index update
+ * - bWaitable adds push()/pop()/pop_batch(), which sleep on std::atomic::wait while the queue is full/empty;
+ *   it costs one atomic increment per publish, so it is opt in
+ * - if constructing or moving out an element throws, the elements before it in the batch are pushed/popped,
+ *   the rest are not, and the exception propagates
+ *
+ *  ut::spsc_queue<record, true> q(1024);
+ *  // producer                   // consumer
+ *  q.push(make_record());        auto rec = q.pop();
+ */
+template <typename T, bool bWaitable = false>
+class spsc_queue
+{
+  public:
+    // capacity is rounded up to a power of two
+    explicit spsc_queue(size_t capacity)
+        : _mask(detail::queue_capacity(capacity) - 1), _slots(std::make_unique<detail::queue_storage<T>[]>(_mask + 1))
+    {
+    }
+    ~spsc_queue()
+    {
+        for (size_t i = _head.load(std::memory_order_relaxed); i != _tail.load(std::memory_order_relaxed); ++i) {
+            _slots[i & _mask].get()->~T();
+        }
+    }
+    spsc_queue(const spsc_queue &)            = delete;
+    spsc_queue &operator=(const spsc_queue &) = delete;
+
+    size_t capacity() const { return _mask + 1; }
+    // exact when called from either end with the other one idle
+    size_t size_approx() const { return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire); }
+    bool   empty() const { return size_approx() == 0; }
+
+    /* producer */
+
+    template <typename... Args>
+    bool try_emplace(Args &&...args)
+    {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head_cache > _mask) {
+            _head_cache = _head.load(std::memory_order_acquire);
+            if (tail - _head_cache > _mask) {
+                return false;
+            }
+        }
+        ::new (_slots[tail & _mask].bytes) T(std::forward<Args>(args)...);
+        _tail.store(tail + 1, std::memory_order_release);
+        _not_empty.notify(false);
+        return true;
+    }
+    bool try_push(const T &value) { return try_emplace(value); }
+    bool try_push(T &&value) { return try_emplace(std::move(value)); }
+
+    // pushes a prefix of [first, last) that fits, returns its length; wrap in std::make_move_iterator to move
+    template <std::input_iterator It>
+        requires std::sized_sentinel_for<It, It>
+    size_t try_push_batch(It first, It last)
+    {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        const size_t want = static_cast<size_t>(last - first);
+        if (capacity() - (tail - _head_cache) < want) {
+            _head_cache = _head.load(std::memory_order_acquire);
+        }
+        const size_t n = std::min(want, capacity() - (tail - _head_cache));
+        size_t       i = 0;
+        try {
+            for (; i < n; ++i, ++first) {
+                ::new (_slots[(tail + i) & _mask].bytes) T(*first);
+            }
+        }
+        catch (...) {
+            publish(tail, i);
+            throw;
+        }
+        publish(tail, n);
+        return n;
+    }
+
+    void push(T value)
+        requires bWaitable
+    {
+        _not_full.wait_for([&]() { return try_emplace(std::move(value)); });
+    }
+
+    /* consumer */
+
+    std::optional<T> try_pop()
+    {
+        std::optional<T> ret;
+        try_pop_batch(&ret, 1);
+        return ret;
+    }
+
+    // moves up to max elements to *out++, returns how many
+    template <typename OutIt>
+    size_t try_pop_batch(OutIt out, size_t max)
+    {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        if (_tail_cache - head < max) {
+            _tail_cache = _tail.load(std::memory_order_acquire);
+        }
+        const size_t n = std::min(max, _tail_cache - head);
+        size_t       i = 0;
+        try {
+            for (; i < n; ++i) {
+                T *p   = _slots[(head + i) & _mask].get();
+                *out++ = std::move(*p);
+                p->~T();
+            }
+        }
+        catch (...) {
+            // the one that failed stays queued
+            release(head, i);
+            throw;
+        }
+        release(head, n);
+        return n;
+    }
+
+    T pop()
+        requires bWaitable
+    {
+        return *_not_empty.wait_for([&]() { return try_pop(); });
+    }
+
+    // waits for at least one element
+    template <typename OutIt>
+    size_t pop_batch(OutIt out, size_t max)
+        requires bWaitable
+    {
+        return max ? _not_empty.wait_for([&]() { return try_pop_batch(out, max); }) : 0;
+    }
+
+  private:
+    using waiter = std::conditional_t<bWaitable, detail::queue_waiter, detail::no_waiter>;
+
+    void publish(size_t tail, size_t n)
+    {
+        if (n) {
+            _tail.store(tail + n, std::memory_order_release);
+            _not_empty.notify(false);
+        }
+    }
+    void release(size_t head, size_t n)
+    {
+        if (n) {
+            _head.store(head + n, std::memory_order_release);
+            _not_full.notify(false);
+        }
+    }
+
+    // written by the producer
+    alignas(detail::cache_line_size) std::atomic<size_t> _tail{0};
+    size_t _head_cache = 0;
+    // written by the consumer
+    alignas(detail::cache_line_size) std::atomic<size_t> _head{0};
+    size_t _tail_cache = 0;
+    // read only
+    alignas(detail::cache_line_size) const size_t _mask;
+    std::unique_ptr<detail::queue_storage<T>[]> _slots;
+
+    [[no_unique_address]] waiter _not_empty;
+    [[no_unique_address]] waiter _not_full;
+};
+
+
+/**
+ * Bounded multi producer / multi consumer ring buffer (Vyukov): every slot carries a sequence number
+ * that says whose turn it is, so producers and consumers only contend on their own index
+ *
+ * - lock-free, a failed CAS means another thread made progress
+ * - try_push_batch()/try_pop_batch() claim a run of ready slots with a single CAS
+ * - bWaitable adds the blocking push()/pop()/pop_batch(), as for spsc_queue
+ * - a claimed slot can't be handed back: if constructing an element throws, the slots claimed for it and the
+ *   rest of its batch are published empty and skipped by consumers; if moving one out throws, it and the rest
+ *   of that pop's run are destroyed. The exception propagates either way, the queue keeps working
+ */
+template <typename T, bool bWaitable = false>
+class mpmc_queue
+{
+  public:
+    // capacity is rounded up to a power of two
+    explicit mpmc_queue(size_t capacity)
+        : _mask(detail::queue_capacity(capacity) - 1), _cells(std::make_unique<cell[]>(_mask + 1))
+    {
+        for (size_t i = 0; i <= _mask; ++i) {
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    ~mpmc_queue()
+    {
+        for (size_t i = _dequeue.load(std::memory_order_relaxed); i != _enqueue.load(std::memory_order_relaxed); ++i) {
+            if (!_cells[i & _mask].bEmpty) {
+                _cells[i & _mask].value.get()->~T();
+            }
+        }
+    }
+    mpmc_queue(const mpmc_queue &)            = delete;
+    mpmc_queue &operator=(const mpmc_queue &) = delete;
+
+    size_t capacity() const { return _mask + 1; }
+    size_t size_approx() const
+    {
+        const size_t dequeue = _dequeue.load(std::memory_order_acquire);
+        const size_t enqueue = _enqueue.load(std::memory_order_acquire);
+        return enqueue > dequeue ? enqueue - dequeue : 0;
+    }
+    bool empty() const { return size_approx() == 0; }
+
+    template <typename... Args>
+    bool try_emplace(Args &&...args)
+    {
+        size_t       n   = 1;
+        const size_t pos = claim(_enqueue, 0, n);
+        if (pos == npos) {
+            return false;
+        }
+        cell &c = _cells[pos & _mask];
+        try {
+            ::new (c.value.bytes) T(std::forward<Args>(args)...);
+        }
+        catch (...) {
+            publish_empty(pos, 0, 1);
+            throw;
+        }
+        c.sequence.store(pos + 1, std::memory_order_release);
+        _not_empty.notify(false);
+        return true;
+    }
+    bool try_push(const T &value) { return try_emplace(value); }
+    bool try_push(T &&value) { return try_emplace(std::move(value)); }
+
+    // pushes a prefix of [first, last) that fits, returns its length; wrap in std::make_move_iterator to move
+    template <std::input_iterator It>
+        requires std::sized_sentinel_for<It, It>
+    size_t try_push_batch(It first, It last)
+    {
+        size_t       n   = static_cast<size_t>(last - first);
+        const size_t pos = n ? claim(_enqueue, 0, n) : npos;
+        if (pos == npos) {
+            return 0;
+        }
+        size_t i = 0;
+        try {
+            for (; i < n; ++i, ++first) {
+                cell &c = _cells[(pos + i) & _mask];
+                ::new (c.value.bytes) T(*first);
+                c.sequence.store(pos + i + 1, std::memory_order_release);
+            }
+        }
+        catch (...) {
+            publish_empty(pos, i, n);
+            throw;
+        }
+        _not_empty.notify(n > 1);
+        return n;
+    }
+
+    void push(T value)
+        requires bWaitable
+    {
+        _not_full.wait_for([&]() { return try_emplace(std::move(value)); });
+    }
+
+    std::optional<T> try_pop()
+    {
+        std::optional<T> ret;
+        try_pop_batch(&ret, 1);
+        return ret;
+    }
+
+    // moves up to max elements to *out++, returns how many (0 is possible after skipping empty slots)
+    template <typename OutIt>
+    size_t try_pop_batch(OutIt out, size_t max)
+    {
+        const size_t pos = max ? claim(_dequeue, 1, max) : npos;
+        if (pos == npos) {
+            return 0;
+        }
+        size_t i = 0, got = 0;
+        try {
+            for (; i < max; ++i) {
+                cell &c = _cells[(pos + i) & _mask];
+                if (!c.bEmpty) {
+                    T *p   = c.value.get();
+                    *out++ = std::move(*p);
+                    p->~T();
+                    ++got;
+                }
+                c.bEmpty = false;
+                c.sequence.store(pos + i + _mask + 1, std::memory_order_release);
+            }
+        }
+        catch (...) {
+            drop_claimed(pos, i, max);
+            throw;
+        }
+        _not_full.notify(max > 1);
+        return got;
+    }
+
+    T pop()
+        requires bWaitable
+    {
+        return *_not_empty.wait_for([&]() { return try_pop(); });
+    }
+
+    // waits for at least one element
+    template <typename OutIt>
+    size_t pop_batch(OutIt out, size_t max)
+        requires bWaitable
+    {
+        return max ? _not_empty.wait_for([&]() { return try_pop_batch(out, max); }) : 0;
+    }
+
+  private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    struct cell
+    {
+        std::atomic<size_t>      sequence;
+        detail::queue_storage<T> value;
+        bool                     bEmpty = false; // published without a value, its constructor threw
+    };
+
+    /**
+     * Advance `index` over up to `n` consecutive slots whose sequence is position + `lag`
+     * (0: free for a producer, 1: filled for a consumer), n is lowered to the run that was claimed.
+     * @return the first claimed position, npos if the first slot isn't ready (full/empty)
+     */
+    size_t claim(std::atomic<size_t> &index, size_t lag, size_t &n)
+    {
+        size_t pos = index.load(std::memory_order_relaxed);
+        while (true) {
+            size_t ready = 0;
+            while (ready < n && _cells[(pos + ready) & _mask].sequence.load(std::memory_order_acquire) == pos + ready + lag) {
+                ++ready;
+            }
+            if (ready) {
+                if (index.compare_exchange_weak(pos, pos + ready, std::memory_order_relaxed)) {
+                    n = ready;
+                    return pos;
+                }
+                continue;
+            }
+            // behind `pos`: the slot is still in use from the previous lap; ahead: someone took pos, reload
+            const size_t sequence = _cells[pos & _mask].sequence.load(std::memory_order_acquire);
+            if (static_cast<std::ptrdiff_t>(sequence - (pos + lag)) < 0) {
+                return npos;
+            }
+            pos = index.load(std::memory_order_relaxed);
+        }
+    }
+
+    // hand the claimed slots [pos + from, pos + n) to the consumers without a value
+    void publish_empty(size_t pos, size_t from, size_t n)
+    {
+        for (size_t i = from; i < n; ++i) {
+            cell &c  = _cells[(pos + i) & _mask];
+            c.bEmpty = true;
+            c.sequence.store(pos + i + 1, std::memory_order_release);
+        }
+        _not_empty.notify(true);
+    }
+
+    // destroy the values in the claimed slots [pos + from, pos + n) and hand the slots back to the producers
+    void drop_claimed(size_t pos, size_t from, size_t n)
+    {
+        for (size_t i = from; i < n; ++i) {
+            cell &c = _cells[(pos + i) & _mask];
+            if (!c.bEmpty) {
+                c.value.get()->~T();
+            }
+            c.bEmpty = false;
+            c.sequence.store(pos + i + _mask + 1, std::memory_order_release);
+        }
+        _not_full.notify(true);
+    }
+
+    using waiter = std::conditional_t<bWaitable, detail::queue_waiter, detail::no_waiter>;
+
+    alignas(detail::cache_line_size) std::atomic<size_t> _enqueue{0};
+    alignas(detail::cache_line_size) std::atomic<size_t> _dequeue{0};
+    alignas(detail::cache_line_size) const size_t _mask;
+    std::unique_ptr<cell[]> _cells;
+
+    [[no_unique_address]] waiter _not_empty;
+    [[no_unique_address]] waiter _not_full;
+};
+
+} // namespace ut
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "plat.h"
+
+namespace ut
+{
+
+/**
+ * Chunked string builder: the text is a sequence of string_view pieces, nothing is contiguous until flatten()
+ *
+ * - append()/insert() copy into an internal block arena, borrow()/insert_borrowed() keep the caller's view
+ *   (which must then outlive the rope); appends are O(1), consecutive arena appends share one piece
+ * - pieces are grouped in leaves of at most 64, so insert/erase/replace at an offset walk the leaves,
+ *   split at most two pieces and never move text
+ * - flatten() copies once into a std::string, write_to() hands the pieces to writev without joining them
+ *
+ *  ut::rope out;
+ *  out.borrow(header);                   // no copy
+ *  out.append(generate_body());          // copied into the arena
+ *  out.insert(header.size(), "// generated\n");
+ *  out.write_to("gen/out.cpp");
+ */
+class UTILITY_CC_API rope
+{
+  public:
+    rope();
+    ~rope();
+
+    rope(rope &&) noexcept;
+    rope &operator=(rope &&) noexcept;
+    rope(const rope &)            = delete; // pieces point into the arena
+    rope &operator=(const rope &) = delete;
+
+    rope &append(std::string_view text);
+    rope &borrow(std::string_view text);
+    rope &operator+=(std::string_view text) { return append(text); }
+
+    // offset > size() is clamped to size(), count past the end to the end
+    void insert(size_t offset, std::string_view text);
+    void insert_borrowed(size_t offset, std::string_view text);
+    void erase(size_t offset, size_t count);
+    void replace(size_t offset, size_t count, std::string_view text);
+    void clear();
+
+    size_t size() const { return _size; }
+    bool   empty() const { return _size == 0; }
+    size_t piece_count() const;
+    char   at(size_t offset) const; // O(leaves), for spot checks rather than iteration
+
+    // fn(std::string_view) for every piece in order
+    template <typename Fn>
+    void for_each_piece(Fn &&fn) const
+    {
+        for (const leaf &l : _leaves) {
+            for (std::string_view piece : l.pieces) {
+                fn(piece);
+            }
+        }
+    }
+
+    std::string flatten() const;
+    void        flatten_into(std::string &out) const; // appends to out
+
+    // create/truncate the file and write every piece (writev batches on POSIX), false + log on failure
+    bool write_to(const std::filesystem::path &filepath) const;
+
+  private:
+    struct leaf
+    {
+        std::vector<std::string_view> pieces;
+        size_t                        bytes = 0;
+    };
+    static constexpr size_t max_pieces = 64;
+    static constexpr size_t block_size = 64 * 1024;
+
+    struct position
+    {
+        size_t leaf;
+        size_t piece;
+    };
+
+    std::string_view copy(std::string_view text);
+    position         split_at(size_t offset); // a piece boundary at offset, returned as the piece starting there
+    void             insert_piece(size_t offset, std::string_view piece);
+    void             split_leaf(size_t index);
+
+    std::vector<leaf>                    _leaves;
+    size_t                               _size = 0;
+    std::vector<std::unique_ptr<char[]>> _blocks;
+    char                                *_block_pos = nullptr;
+    size_t                               _block_left = 0;
+};
+
+} // namespace ut
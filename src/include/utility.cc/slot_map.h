@@ -0,0 +1,226 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace ut
+{
+
+/**
+ * Index + generation packed into one integer, the low IndexBits hold the slot index
+ * A default constructed handle is null: generations start at 1.
+ */
+template <typename Int, unsigned IndexBits>
+struct slot_handle
+{
+    static_assert(std::is_unsigned_v<Int> && IndexBits > 0 && IndexBits < sizeof(Int) * 8);
+
+    static constexpr Int index_mask = (Int(1) << IndexBits) - 1;
+    static constexpr Int max_gen    = Int(~Int(0)) >> IndexBits;
+
+    Int bits = 0;
+
+    constexpr slot_handle() = default;
+    constexpr slot_handle(uint32_t index, Int generation) : bits(static_cast<Int>(generation << IndexBits | index)) {}
+
+    constexpr uint32_t index() const { return static_cast<uint32_t>(bits & index_mask); }
+    constexpr Int      generation() const { return bits >> IndexBits; }
+
+    constexpr explicit operator bool() const { return bits != 0; }
+    constexpr bool     operator==(const slot_handle &) const = default;
+};
+
+using slot_handle32 = slot_handle<uint32_t, 20>; // 1M slots, 4095 reuses per slot
+using slot_handle64 = slot_handle<uint64_t, 32>;
+
+/**
+ * Values stored contiguously, addressed through generation checked handles
+ *
+ * - insert/erase/lookup are O(1); erase moves the last value into the hole (swap and pop),
+ *   so iteration order changes and pointers/references into the map are invalidated like a vector's
+ * - a handle to an erased value never resolves again, even once its slot is reused
+ * - a slot whose generation runs out is retired instead of wrapping around
+ *
+ *  ut::slot_map<Entity> entities;
+ *  auto h = entities.insert(Entity{...});
+ *  if (Entity *e = entities.get(h)) { ... }
+ *  for (auto [i, e] : ut::enumerate(entities)) { entities.handle_at(i); }
+ */
+template <typename T, typename Handle = slot_handle32>
+class slot_map
+{
+  public:
+    using handle          = Handle;
+    using value_type      = T;
+    using size_type       = size_t;
+    using reference       = T &;
+    using const_reference = const T &;
+    using iterator        = typename std::vector<T>::iterator;
+    using const_iterator  = typename std::vector<T>::const_iterator;
+
+    static constexpr size_t max_slots = size_t(Handle::index_mask); // index_mask itself marks the end of the free list
+
+    template <typename... Args>
+    handle emplace(Args &&...args)
+    {
+        uint32_t index = acquire_slot();
+        try {
+            _dense_to_slot.push_back(index);
+            _values.emplace_back(std::forward<Args>(args)...);
+        }
+        catch (...) {
+            // the constructor or the growth threw: the map is as before
+            _dense_to_slot.resize(_values.size());
+            unacquire_slot(index);
+            throw;
+        }
+        slot &s = _slots[index];
+        s.dense = static_cast<uint32_t>(_values.size() - 1);
+        return handle(index, s.generation);
+    }
+
+    handle insert(const T &value) { return emplace(value); }
+    handle insert(T &&value) { return emplace(std::move(value)); }
+
+    bool erase(handle h)
+    {
+        if (!contains(h)) {
+            return false;
+        }
+        slot          &s    = _slots[h.index()];
+        const uint32_t hole = s.dense;
+        const uint32_t last = static_cast<uint32_t>(_values.size() - 1);
+        if (hole != last) {
+            _values[hole]                      = std::move(_values[last]);
+            _dense_to_slot[hole]               = _dense_to_slot[last];
+            _slots[_dense_to_slot[hole]].dense = hole;
+        }
+        _values.pop_back();
+        _dense_to_slot.pop_back();
+        release_slot(h.index());
+        return true;
+    }
+
+    bool contains(handle h) const
+    {
+        return h.index() < _slots.size() && _slots[h.index()].generation == h.generation() && _slots[h.index()].bLive;
+    }
+
+    T *get(handle h) { return contains(h) ? &_values[_slots[h.index()].dense] : nullptr; }
+    const T *get(handle h) const { return contains(h) ? &_values[_slots[h.index()].dense] : nullptr; }
+
+    T &at(handle h)
+    {
+        if (!contains(h)) {
+            throw std::out_of_range("slot_map::at: stale or invalid handle");
+        }
+        return _values[_slots[h.index()].dense];
+    }
+    const T &at(handle h) const { return const_cast<slot_map *>(this)->at(h); }
+
+    // unchecked, h must be live
+    T       &operator[](handle h) { return _values[_slots[h.index()].dense]; }
+    const T &operator[](handle h) const { return _values[_slots[h.index()].dense]; }
+
+    // handle of the i-th value in iteration order
+    handle handle_at(size_t i) const
+    {
+        uint32_t index = _dense_to_slot[i];
+        return handle(index, _slots[index].generation);
+    }
+
+    void reserve(size_t n)
+    {
+        _values.reserve(n);
+        _dense_to_slot.reserve(n);
+        _slots.reserve(n);
+    }
+
+    // every outstanding handle becomes stale, slots are kept for reuse
+    void clear()
+    {
+        for (uint32_t index : _dense_to_slot) {
+            release_slot(index);
+        }
+        _values.clear();
+        _dense_to_slot.clear();
+    }
+
+    size_t size() const { return _values.size(); }
+    bool   empty() const { return _values.empty(); }
+
+    T       *data() { return _values.data(); }
+    const T *data() const { return _values.data(); }
+
+    std::span<T>       values() { return _values; }
+    std::span<const T> values() const { return _values; }
+
+    iterator       begin() { return _values.begin(); }
+    iterator       end() { return _values.end(); }
+    const_iterator begin() const { return _values.begin(); }
+    const_iterator end() const { return _values.end(); }
+
+  private:
+    using generation_t = decltype(Handle{}.generation());
+
+    struct slot
+    {
+        uint32_t     dense      = 0; // position in _values while live, next free slot otherwise
+        generation_t generation = 1;
+        bool         bLive      = false;
+    };
+
+    static constexpr uint32_t no_slot = static_cast<uint32_t>(Handle::index_mask);
+
+    uint32_t acquire_slot()
+    {
+        uint32_t index;
+        if (_free_head != no_slot) {
+            index      = _free_head;
+            _free_head = _slots[index].dense;
+        }
+        else {
+            if (_slots.size() >= max_slots) {
+                throw std::length_error("slot_map: out of slots");
+            }
+            index = static_cast<uint32_t>(_slots.size());
+            _slots.emplace_back();
+        }
+        _slots[index].bLive = true;
+        return index;
+    }
+
+    // undo acquire_slot(), the generation stays: no handle to the slot was given out
+    void unacquire_slot(uint32_t index)
+    {
+        slot &s    = _slots[index];
+        s.bLive    = false;
+        s.dense    = _free_head;
+        _free_head = index;
+    }
+
+    void release_slot(uint32_t index)
+    {
+        slot &s = _slots[index];
+        s.bLive = false;
+        if (s.generation == Handle::max_gen) {
+            return; // retired: reusing it would bring back a handle value already given out
+        }
+        ++s.generation;
+        s.dense    = _free_head;
+        _free_head = index;
+    }
+
+    std::vector<T>        _values;
+    std::vector<uint32_t> _dense_to_slot;
+    std::vector<slot>     _slots;
+    uint32_t              _free_head = no_slot;
+};
+
+} // namespace ut
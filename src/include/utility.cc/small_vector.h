@@ -0,0 +1,319 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+
+namespace ut
+{
+
+/**
+ * std::vector-like container that keeps the first N elements inside the object
+ *
+ * - no allocation until the (N+1)th element, then spills everything to the heap like std::vector
+ * - moving a spilled vector steals the heap buffer, moving an inline one moves the elements
+ * - iterators are invalidated by any growth and by moves, as for std::vector
+ */
+template <typename T, size_t N>
+class small_vector
+{
+    static_assert(N > 0);
+
+  public:
+    using value_type      = T;
+    using size_type       = size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference       = T &;
+    using const_reference = const T &;
+    using pointer         = T *;
+    using const_pointer   = const T *;
+    using iterator        = T *;
+    using const_iterator  = const T *;
+
+    static constexpr size_t inline_capacity = N;
+
+    small_vector() = default;
+
+    explicit small_vector(size_t n) { resize(n); }
+    small_vector(size_t n, const T &value) { resize(n, value); }
+    small_vector(std::initializer_list<T> init) : small_vector(init.begin(), init.end()) {}
+
+    template <std::input_iterator It>
+    small_vector(It first, It last)
+    {
+        if constexpr (std::forward_iterator<It>) {
+            reserve(static_cast<size_t>(std::distance(first, last)));
+        }
+        for (; first != last; ++first) {
+            emplace_back(*first);
+        }
+    }
+
+    small_vector(const small_vector &other)
+    {
+        reserve(other._size);
+        std::uninitialized_copy(other.begin(), other.end(), _data);
+        _size = other._size;
+    }
+
+    small_vector(small_vector &&other) noexcept(std::is_nothrow_move_constructible_v<T>) { steal(other); }
+
+    small_vector &operator=(const small_vector &other)
+    {
+        if (this != &other) {
+            clear();
+            reserve(other._size);
+            std::uninitialized_copy(other.begin(), other.end(), _data);
+            _size = other._size;
+        }
+        return *this;
+    }
+
+    small_vector &operator=(small_vector &&other) noexcept(std::is_nothrow_move_constructible_v<T>)
+    {
+        if (this != &other) {
+            clear();
+            release();
+            steal(other);
+        }
+        return *this;
+    }
+
+    small_vector &operator=(std::initializer_list<T> init)
+    {
+        clear();
+        reserve(init.size());
+        for (const T &v : init) {
+            emplace_back(v);
+        }
+        return *this;
+    }
+
+    ~small_vector()
+    {
+        clear();
+        release();
+    }
+
+
+    size_t size() const { return _size; }
+    size_t capacity() const { return _capacity; }
+    bool   empty() const { return _size == 0; }
+
+    // false as long as the elements live in the inline buffer
+    bool on_heap() const { return _data != inline_data(); }
+
+    T       *data() { return _data; }
+    const T *data() const { return _data; }
+
+    iterator       begin() { return _data; }
+    iterator       end() { return _data + _size; }
+    const_iterator begin() const { return _data; }
+    const_iterator end() const { return _data + _size; }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    auto rbegin() { return std::reverse_iterator(end()); }
+    auto rend() { return std::reverse_iterator(begin()); }
+    auto rbegin() const { return std::reverse_iterator(end()); }
+    auto rend() const { return std::reverse_iterator(begin()); }
+
+    T       &operator[](size_t i) { return _data[i]; }
+    const T &operator[](size_t i) const { return _data[i]; }
+
+    T &at(size_t i)
+    {
+        if (i >= _size) {
+            throw std::out_of_range("ut::small_vector index out of range");
+        }
+        return _data[i];
+    }
+    const T &at(size_t i) const { return const_cast<small_vector *>(this)->at(i); }
+
+    T       &front() { return _data[0]; }
+    const T &front() const { return _data[0]; }
+    T       &back() { return _data[_size - 1]; }
+    const T &back() const { return _data[_size - 1]; }
+
+
+    void reserve(size_t n)
+    {
+        if (n > _capacity) {
+            T *next = allocate(n);
+            try {
+                relocate_into(next);
+            }
+            catch (...) {
+                std::allocator<T>().deallocate(next, n);
+                throw;
+            }
+            adopt(next, n);
+        }
+    }
+
+    template <typename... Args>
+    T &emplace_back(Args &&...args)
+    {
+        if (_size < _capacity) {
+            ::new (static_cast<void *>(_data + _size)) T(std::forward<Args>(args)...);
+        }
+        else {
+            // build the new element before moving the old ones: args may refer into this vector
+            size_t cap  = std::max(_capacity * 2, _size + 1);
+            T     *next = allocate(cap);
+            try {
+                ::new (static_cast<void *>(next + _size)) T(std::forward<Args>(args)...);
+            }
+            catch (...) {
+                std::allocator<T>().deallocate(next, cap);
+                throw;
+            }
+            try {
+                relocate_into(next);
+            }
+            catch (...) {
+                std::destroy_at(next + _size);
+                std::allocator<T>().deallocate(next, cap);
+                throw;
+            }
+            adopt(next, cap);
+        }
+        return _data[_size++];
+    }
+
+    void push_back(const T &value) { emplace_back(value); }
+    void push_back(T &&value) { emplace_back(std::move(value)); }
+
+    void pop_back()
+    {
+        --_size;
+        std::destroy_at(_data + _size);
+    }
+
+    template <typename... Args>
+    iterator emplace(const_iterator pos, Args &&...args)
+    {
+        size_t i = static_cast<size_t>(pos - begin());
+        emplace_back(std::forward<Args>(args)...);
+        std::rotate(begin() + i, end() - 1, end());
+        return begin() + i;
+    }
+
+    iterator insert(const_iterator pos, const T &value) { return emplace(pos, value); }
+    iterator insert(const_iterator pos, T &&value) { return emplace(pos, std::move(value)); }
+
+    iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        iterator dst = begin() + (first - begin());
+        iterator src = begin() + (last - begin());
+        if (dst != src) {
+            iterator new_end = std::move(src, end(), dst);
+            std::destroy(new_end, end());
+            _size = static_cast<size_t>(new_end - begin());
+        }
+        return dst;
+    }
+
+    void resize(size_t n) { resize_impl(n); }
+    void resize(size_t n, const T &value) { resize_impl(n, value); }
+
+    // destroys the elements, keeps the capacity (inline or heap)
+    void clear()
+    {
+        std::destroy(begin(), end());
+        _size = 0;
+    }
+
+
+    friend bool operator==(const small_vector &a, const small_vector &b)
+    {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end());
+    }
+
+  private:
+    T       *inline_data() { return std::launder(reinterpret_cast<T *>(_inline)); }
+    const T *inline_data() const { return std::launder(reinterpret_cast<const T *>(_inline)); }
+
+    static T *allocate(size_t n) { return std::allocator<T>().allocate(n); }
+
+    void release()
+    {
+        if (on_heap()) {
+            std::allocator<T>().deallocate(_data, _capacity);
+            _data     = inline_data();
+            _capacity = N;
+        }
+    }
+
+    /**
+     * Build the elements in `next`, moved, or copied when the move may throw and a copy exists (std::move_if_noexcept).
+     * If one throws, those already built are destroyed and this is untouched: the strong guarantee of std::vector.
+     */
+    void relocate_into(T *next)
+    {
+        if constexpr (std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>) {
+            std::uninitialized_move(begin(), end(), next);
+        }
+        else {
+            std::uninitialized_copy(begin(), end(), next);
+        }
+    }
+
+    // switch to `next` (heap, filled by relocate_into), destroying the old elements and freeing their buffer
+    void adopt(T *next, size_t capacity)
+    {
+        std::destroy(begin(), end());
+        release();
+        _data     = next;
+        _capacity = capacity;
+    }
+
+    // called with this empty and inline, leaves other empty and inline
+    void steal(small_vector &other)
+    {
+        if (other.on_heap()) {
+            _data     = other._data;
+            _size     = other._size;
+            _capacity = other._capacity;
+
+            other._data     = other.inline_data();
+            other._size     = 0;
+            other._capacity = N;
+        }
+        else {
+            std::uninitialized_move(other.begin(), other.end(), _data);
+            _size = other._size;
+            other.clear();
+        }
+    }
+
+    template <typename... Value>
+    void resize_impl(size_t n, const Value &...value)
+    {
+        if (n < _size) {
+            std::destroy(begin() + n, end());
+            _size = n;
+            return;
+        }
+        reserve(n);
+        for (; _size < n; ++_size) {
+            ::new (static_cast<void *>(_data + _size)) T(value...);
+        }
+    }
+
+    T     *_data     = inline_data();
+    size_t _size     = 0;
+    size_t _capacity = N;
+
+    alignas(T) unsigned char _inline[N * sizeof(T)];
+};
+
+} // namespace ut
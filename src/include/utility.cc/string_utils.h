@@ -9,13 +9,24 @@
 
 #pragma once
 
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
 #include <format>
+#include <initializer_list>
+#include <limits>
+#include <optional>
+#include <span>
 #include <string>
 #include <string_view>
+#include <type_traits>
 #include <vector>
 
 
+#include "inline_string.h"
 #include "plat.h"
+#include "small_vector.h"
 
 namespace ut
 {
@@ -33,6 +44,139 @@ UTILITY_CC_API std::string toLower(std::string_view source);
 UTILITY_CC_API std::string toUpper(std::string_view source);
 UTILITY_CC_API std::string concat(std::vector<std::string_view> source, const std::string_view delimiter = "");
 
+
+/*
+substring search: candidates come from comparing two bytes of the needle against 64 haystack positions at once,
+only those are verified with memcmp ("generic SIMD" memmem), so long scans run close to memory bandwidth
+*/
+
+// like std::string_view::find, filtering on the needle's first and last byte
+UTILITY_CC_API size_t find(std::string_view haystack, std::string_view needle, size_t pos = 0);
+
+/**
+ * A needle prepared for many haystacks: filters on its two rarest bytes (by a static frequency table of text),
+ *  which keeps false candidates rare when the needle starts or ends with common letters or spaces.
+ */
+class UTILITY_CC_API searcher
+{
+  public:
+    explicit searcher(std::string_view needle);
+
+    size_t           find(std::string_view haystack, size_t pos = 0) const; // npos if absent
+    std::string_view needle() const { return _needle; }
+
+  private:
+    std::string _needle;
+    uint32_t    _rare1 = 0, _rare2 = 0; // offsets of the filter bytes
+};
+
+/**
+ * Every occurrence of a small set of patterns (a few dozen at most) in one pass over the haystack.
+ * Overlapping matches are all reported, ordered by offset and then by pattern index. Empty patterns never match.
+ *
+ *  ut::str::multi_searcher markers({"ERROR", "WARN", "assert"});
+ *  for (auto [offset, pattern] : markers.find_all(log_text)) { ... }
+ */
+class UTILITY_CC_API multi_searcher
+{
+  public:
+    struct match
+    {
+        size_t   offset;
+        uint32_t pattern; // index in the constructor's list
+
+        bool operator==(const match &) const = default;
+    };
+
+    explicit multi_searcher(std::span<const std::string_view> patterns);
+    multi_searcher(std::initializer_list<std::string_view> patterns) : multi_searcher(std::span(patterns.begin(), patterns.size())) {}
+
+    std::vector<match> find_all(std::string_view haystack) const;
+    void               find_all(std::string_view haystack, std::vector<match> &out) const; // appends to out
+
+    size_t size() const { return _patterns.size(); }
+
+  private:
+    // the two rarest bytes of a non-empty pattern
+    struct filter
+    {
+        uint32_t o1, o2;
+        char     c1, c2;
+        uint32_t pattern;
+    };
+    std::vector<std::string> _patterns;
+    std::vector<filter>      _filters;
+    size_t                   _max_size = 0;
+};
+
+/*
+overloads that write into a caller provided container/string instead of returning heap backed std::strings
+*/
+
+/**
+ * Split into any container whose elements can be built from a std::string_view,
+ *  e.g. std::vector<ut::inline_string<32>> or std::vector<std::string_view> (no copies at all).
+ * `out` is appended to, not cleared.
+ */
+template <typename Container>
+    requires requires(Container &c, std::string_view sv) { c.emplace_back(sv); }
+void split(std::string_view source, char delimiter, Container &out)
+{
+    while (true) {
+        size_t n = source.find(delimiter);
+        if (n == std::string_view::npos) {
+            out.emplace_back(source);
+            break;
+        }
+        out.emplace_back(source.substr(0, n));
+        source.remove_prefix(n + 1);
+    }
+}
+
+/**
+ * Split into views of `source` held inline for up to N fields, e.g. `auto kv = str::split_view<2>("key=value", '=');`
+ * Nothing is allocated unless there are more than N fields. The views point into `source`.
+ */
+template <size_t N = 8>
+small_vector<std::string_view, N> split_view(std::string_view source, char delimiter = ' ')
+{
+    small_vector<std::string_view, N> ret;
+    split(source, delimiter, ret);
+    return ret;
+}
+
+template <size_t N, inline_overflow Overflow>
+void toLower(std::string_view source, inline_string<N, Overflow> &out)
+{
+    out.resize(source.size()); // shorter than source with inline_overflow::truncate
+    for (size_t i = 0; i < out.size(); ++i) {
+        char c = source[i];
+        out[i] = (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+}
+
+template <size_t N, inline_overflow Overflow>
+void toUpper(std::string_view source, inline_string<N, Overflow> &out)
+{
+    out.resize(source.size());
+    for (size_t i = 0; i < out.size(); ++i) {
+        char c = source[i];
+        out[i] = (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+    }
+}
+
+template <size_t N, inline_overflow Overflow>
+void concat(std::span<const std::string_view> source, const std::string_view delimiter, inline_string<N, Overflow> &out)
+{
+    out.clear();
+    for (size_t i = 0; i < source.size(); ++i) {
+        if (i > 0) {
+            out.append(delimiter);
+        }
+        out.append(source[i]);
+    }
+}
+
 template <typename T>
 std::string join(const T &container, const std::string_view delimiter = "")
 {
@@ -43,16 +187,185 @@ std::string join(const T &container, const std::string_view delimiter = "")
         {
             result += delimiter;
         }
-        if (!it) {
-            continue;
+        if constexpr (std::is_pointer_v<std::remove_cvref_t<decltype(*it)>>) {
+            if (!*it) {
+                continue;
+            }
         }
-        if constexpr (requires { std::to_string(*it)->std::string; })
+        if constexpr (std::is_convertible_v<decltype(*it), std::string_view>)
+        {
+            result += std::string_view(*it);
+        }
+        else
         {
             result += std::format("{}", *it);
         }
     }
     return result;
 }
+
+
+/*
+number conversion: std::from_chars/to_chars based, no locale, no exceptions, no null terminator needed
+*/
+
+namespace detail
+{
+
+// all 8 bytes are '0'..'9'
+inline bool is_8_digits(uint64_t v)
+{
+    return ((v & 0xF0F0F0F0F0F0F0F0) | (((v + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) == 0x3333333333333333;
+}
+
+// SWAR: 8 ascii digits (little endian load) to their value with 3 multiplications
+inline uint32_t parse_8_digits(uint64_t v)
+{
+    constexpr uint64_t mask = 0x000000FF000000FF;
+    constexpr uint64_t mul1 = 100 + (1000000ULL << 32);
+    constexpr uint64_t mul2 = 1 + (10000ULL << 32);
+
+    v -= 0x3030303030303030;
+    v = (v * 10) + (v >> 8);
+    v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+    return static_cast<uint32_t>(v);
+}
+
+template <typename T>
+std::optional<T> parse_integer(std::string_view source)
+{
+    const char *p   = source.data();
+    const char *end = p + source.size();
+
+    bool bNegative = false;
+    if constexpr (std::is_signed_v<T>) {
+        if (p != end && *p == '-') {
+            bNegative = true;
+            ++p;
+        }
+    }
+
+    // up to 19 digits always fit into uint64_t, longer inputs go through from_chars for the overflow check
+    if (p == end || end - p > 19) {
+        T value{};
+        auto [ptr, ec] = std::from_chars(source.data(), end, value);
+        if (ec != std::errc() || ptr != end) {
+            return std::nullopt;
+        }
+        return value;
+    }
+
+    uint64_t acc = 0;
+    if constexpr (std::endian::native == std::endian::little) {
+        while (end - p >= 8) {
+            uint64_t chunk;
+            std::memcpy(&chunk, p, 8);
+            if (!is_8_digits(chunk)) {
+                return std::nullopt;
+            }
+            acc = acc * 100000000 + parse_8_digits(chunk);
+            p += 8;
+        }
+    }
+    for (; p != end; ++p) {
+        unsigned d = static_cast<unsigned char>(*p) - '0';
+        if (d > 9) {
+            return std::nullopt;
+        }
+        acc = acc * 10 + d;
+    }
+
+    if constexpr (std::is_signed_v<T>) {
+        using U = std::make_unsigned_t<T>;
+        if (bNegative) {
+            if (acc > static_cast<uint64_t>(std::numeric_limits<T>::max()) + 1) {
+                return std::nullopt;
+            }
+            return static_cast<T>(static_cast<U>(0) - static_cast<U>(acc));
+        }
+    }
+    if (acc > static_cast<uint64_t>(std::numeric_limits<T>::max())) {
+        return std::nullopt;
+    }
+    return static_cast<T>(acc);
+}
+
+} // namespace detail
+
+
+/**
+ * Parse the whole of `source` as a T, e.g. str::parse<int>("42")
+ * Same grammar as std::from_chars: no leading '+' or whitespace, floats accept inf/nan
+ * @return nullopt on junk before/after the number or when it doesn't fit into T
+ */
+template <typename T>
+    requires(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>)
+std::optional<T> parse(std::string_view source)
+{
+    if constexpr (std::is_integral_v<T>) {
+        return detail::parse_integer<T>(source);
+    }
+    else {
+        T value{};
+        auto [ptr, ec] = std::from_chars(source.data(), source.data() + source.size(), value);
+        if (ec != std::errc() || ptr != source.data() + source.size() || source.empty()) {
+            return std::nullopt;
+        }
+        return value;
+    }
+}
+
+/**
+ * Parse a delimited column ("1,2,3" or one number per line) into `out` in a single pass, no token copies
+ * An empty last token (trailing delimiter) is ignored.
+ * @return false at the first invalid token, `out` keeps the values parsed before it
+ */
+template <typename T>
+    requires(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>)
+bool parse_column(std::string_view source, char delimiter, std::vector<T> &out)
+{
+    const char *p   = source.data();
+    const char *end = p + source.size();
+    while (p != end) {
+        const char *next = static_cast<const char *>(std::memchr(p, delimiter, static_cast<size_t>(end - p)));
+        const char *stop = next ? next : end;
+
+        auto value = parse<T>(std::string_view(p, static_cast<size_t>(stop - p)));
+        if (!value) {
+            return false;
+        }
+        out.push_back(*value);
+
+        if (!next) {
+            break;
+        }
+        p = next + 1;
+    }
+    return true;
+}
+
+/**
+ * Write value into buf with std::to_chars (shortest round trip form for floats), no null terminator
+ * @return the written part of buf, empty if buf is too small
+ */
+template <typename T>
+    requires(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>)
+std::string_view format_to(std::span<char> buf, T value)
+{
+    auto [ptr, ec] = std::to_chars(buf.data(), buf.data() + buf.size(), value);
+    if (ec != std::errc()) {
+        return {};
+    }
+    return std::string_view(buf.data(), static_cast<size_t>(ptr - buf.data()));
+}
+
+template <size_t N, inline_overflow Overflow, typename T>
+    requires(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>)
+void format_to(inline_string<N, Overflow> &out, T value)
+{
+    char buf[64]; // enough for any integer and the shortest form of a double
+    out.assign(format_to(std::span<char>(buf), value));
+}
 } // namespace str
 
 
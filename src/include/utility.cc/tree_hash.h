@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "parallel.h"
+#include "plat.h"
+
+namespace ut
+{
+
+namespace file
+{
+
+/**
+ * Merkle tree over fixed size chunks of a file: chunk digests are computed in parallel, straight from a mapping
+ *
+ * - a leaf is the XXH64 of the chunk mixed with its index, so a stored root stays valid across platforms and builds;
+ *   a parent mixes its two children, an odd node moves up unchanged; the root also covers the total size
+ * - the tree's shape depends only on size and chunk_size, so the root is the same for any thread count
+ * - one chunk can be verified or replaced in O(log n) without touching the rest of the file
+ * - for change detection and integrity against accidents, not a cryptographic hash
+ *
+ *  auto tree = ut::file::tree_hash::of_file("assets.pak");
+ *  tree->update_chunk(7, patched_chunk);
+ */
+class UTILITY_CC_API tree_hash
+{
+  public:
+    struct options
+    {
+        size_t           chunk_size = 1 << 20;
+        parallel_options parallel   = {.grain = 1};
+    };
+
+    static tree_hash                of(std::string_view data);
+    static tree_hash                of(std::string_view data, options opt);
+    static std::optional<tree_hash> of_file(const std::filesystem::path &filepath);
+    static std::optional<tree_hash> of_file(const std::filesystem::path &filepath, options opt);
+
+    uint64_t root() const { return _root; }
+    uint64_t size() const { return _size; }
+    size_t   chunk_size() const { return _chunk_size; }
+    size_t   chunk_count() const { return _levels.front().size(); } // at least 1, an empty input has one empty chunk
+
+    uint64_t chunk(size_t index) const { return _levels.front()[index]; }
+    size_t   chunk_offset(size_t index) const { return index * _chunk_size; }
+    size_t   chunk_length(size_t index) const;
+
+    // whether `bytes` are what chunk `index` held when hashed
+    bool verify_chunk(size_t index, std::string_view bytes) const;
+
+    // replace chunk `index` (same length as before) and rehash its path to the root; false if index or length don't fit
+    bool update_chunk(size_t index, std::string_view bytes);
+
+  private:
+    tree_hash() = default;
+
+    void build(std::string_view data, const options &opt);
+    void rehash_from(size_t index);
+
+    std::vector<std::vector<uint64_t>> _levels; // leaves first, the single top node last
+    uint64_t                           _root       = 0;
+    uint64_t                           _size       = 0;
+    size_t                             _chunk_size = 0;
+};
+
+} // namespace file
+
+} // namespace ut
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "plat.h"
+
+/*
+UTF-8 validation, code point counting and UTF-8 <-> UTF-16/UTF-32 transcoding
+
+- validation is the lookup table algorithm (Keiser & Lemire, "Validating UTF-8 in less than one instruction per byte"),
+  SSSE3 picked at runtime on x86, NEON on AArch64, a scalar decoder otherwise; ASCII blocks take a shortcut
+- "valid" means RFC 3629: no overlong forms, no surrogates, nothing above U+10FFFF
+- transcoders reject invalid input (lone surrogates in UTF-16 included) instead of substituting U+FFFD
+*/
+
+namespace ut
+{
+
+namespace utf
+{
+
+UTILITY_CC_API bool validate(std::string_view utf8);
+
+// length of the longest valid prefix, utf8.size() when everything is valid
+UTILITY_CC_API size_t valid_prefix(std::string_view utf8);
+
+// number of code points of valid UTF-8 (counts the bytes that aren't continuation bytes)
+UTILITY_CC_API size_t count_code_points(std::string_view utf8);
+
+/*
+out is replaced, and left in an unspecified state when false is returned
+*/
+UTILITY_CC_API bool to_utf16(std::string_view utf8, std::u16string &out);
+UTILITY_CC_API bool to_utf32(std::string_view utf8, std::u32string &out);
+UTILITY_CC_API bool from_utf16(std::u16string_view utf16, std::string &out);
+UTILITY_CC_API bool from_utf32(std::u32string_view utf32, std::string &out);
+
+inline std::optional<std::u16string> to_utf16(std::string_view utf8)
+{
+    std::u16string out;
+    return to_utf16(utf8, out) ? std::optional(std::move(out)) : std::nullopt;
+}
+
+inline std::optional<std::u32string> to_utf32(std::string_view utf8)
+{
+    std::u32string out;
+    return to_utf32(utf8, out) ? std::optional(std::move(out)) : std::nullopt;
+}
+
+inline std::optional<std::string> from_utf16(std::u16string_view utf16)
+{
+    std::string out;
+    return from_utf16(utf16, out) ? std::optional(std::move(out)) : std::nullopt;
+}
+
+inline std::optional<std::string> from_utf32(std::u32string_view utf32)
+{
+    std::string out;
+    return from_utf32(utf32, out) ? std::optional(std::move(out)) : std::nullopt;
+}
+
+} // namespace utf
+
+} // namespace ut
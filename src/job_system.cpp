@@ -0,0 +1,695 @@
+#include "utility.cc/job_system.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+
+namespace ut
+{
+
+namespace detail
+{
+
+struct job
+{
+    std::function<void()> fn;
+    std::exception_ptr    error;
+
+    std::atomic<int>  refs{0};    // the scheduler until it finished + one per job_handle
+    std::atomic<int>  pending{0}; // unfinished dependencies + 1 for submit() itself
+    std::atomic<bool> bDone{false};
+    std::atomic<int>  waiters{0}; // threads sleeping in wait() on this job
+
+    std::atomic_flag   lock = ATOMIC_FLAG_INIT; // guards continuations
+    std::vector<job *> continuations;           // jobs waiting for this one, no extra reference
+
+    void lock_continuations()
+    {
+        while (lock.test_and_set(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+    }
+    void unlock_continuations() { lock.clear(std::memory_order_release); }
+};
+
+
+/**
+ * Free lists of job objects, same idea as ObjectPool but shared by threads:
+ *  every thread keeps a small cache, surplus goes to a locked global list
+ */
+struct job_pool
+{
+    static constexpr size_t LOCAL_MAX = 256;
+    static constexpr size_t TRANSFER  = 64;
+
+    std::mutex         mutex;
+    std::vector<job *> free;
+
+    struct local_cache
+    {
+        std::vector<job *> items;
+        ~local_cache()
+        {
+            bGone = true;
+            for (job *j : items) {
+                delete j;
+            }
+        }
+
+        // trivially destructible, so still readable after the cache itself is gone
+        static inline thread_local bool bGone = false;
+    };
+
+    static job_pool &instance()
+    {
+        static job_pool pool;
+        return pool;
+    }
+
+    // null once this thread's cache was destroyed: a job released later in thread exit or static destruction
+    // (the global scheduler shutting down) goes through the locked list instead
+    static local_cache *local()
+    {
+        static thread_local local_cache cache;
+        return local_cache::bGone ? nullptr : &cache;
+    }
+
+    ~job_pool()
+    {
+        for (job *j : free) {
+            delete j;
+        }
+    }
+
+    job *acquire()
+    {
+        local_cache *l = local();
+        if (!l) {
+            std::lock_guard lock(mutex);
+            if (free.empty()) {
+                return new job();
+            }
+            job *j = free.back();
+            free.pop_back();
+            return j;
+        }
+
+        auto &cache = l->items;
+        if (cache.empty()) {
+            std::lock_guard lock(mutex);
+            size_t          n = std::min(TRANSFER, free.size());
+            cache.insert(cache.end(), free.end() - n, free.end());
+            free.resize(free.size() - n);
+        }
+        if (cache.empty()) {
+            return new job();
+        }
+        job *j = cache.back();
+        cache.pop_back();
+        return j;
+    }
+
+    void release(job *j)
+    {
+        j->fn    = nullptr; // drop the captures now, not on reuse
+        j->error = nullptr;
+        j->continuations.clear();
+        j->bDone.store(false, std::memory_order_relaxed);
+        j->waiters.store(0, std::memory_order_relaxed);
+
+        local_cache *l = local();
+        if (!l) {
+            std::lock_guard lock(mutex);
+            free.push_back(j);
+            return;
+        }
+
+        auto &cache = l->items;
+        cache.push_back(j);
+        if (cache.size() > LOCAL_MAX) {
+            std::lock_guard lock(mutex);
+            free.insert(free.end(), cache.end() - TRANSFER, cache.end());
+            cache.resize(cache.size() - TRANSFER);
+        }
+    }
+};
+
+static void release_ref(job *j)
+{
+    if (j->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        job_pool::instance().release(j);
+    }
+}
+
+
+/**
+ * Chase-Lev deque, "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al. 2013)
+ * The owner pushes and pops at the bottom, any thread may steal from the top.
+ */
+class work_stealing_deque
+{
+    struct ring
+    {
+        int64_t                               capacity;
+        std::unique_ptr<std::atomic<job *>[]> items;
+
+        explicit ring(int64_t cap) : capacity(cap), items(new std::atomic<job *>[cap]) {}
+
+        job *get(int64_t i) const { return items[i & (capacity - 1)].load(std::memory_order_relaxed); }
+        void put(int64_t i, job *j) { items[i & (capacity - 1)].store(j, std::memory_order_relaxed); }
+    };
+
+    std::atomic<int64_t>               _top{0};
+    std::atomic<int64_t>               _bottom{0};
+    std::atomic<ring *>                _ring;
+    std::vector<std::unique_ptr<ring>> _rings; // old rings stay alive, a thief may still read them
+
+  public:
+    explicit work_stealing_deque(int64_t capacity = 256)
+    {
+        _rings.emplace_back(new ring(capacity));
+        _ring.store(_rings.back().get(), std::memory_order_relaxed);
+    }
+
+    // owner only
+    void push(job *j)
+    {
+        int64_t b = _bottom.load(std::memory_order_relaxed);
+        int64_t t = _top.load(std::memory_order_acquire);
+        ring   *r = _ring.load(std::memory_order_relaxed);
+
+        if (b - t > r->capacity - 1) {
+            auto bigger = std::make_unique<ring>(r->capacity * 2);
+            for (int64_t i = t; i < b; ++i) {
+                bigger->put(i, r->get(i));
+            }
+            r = bigger.get();
+            _rings.push_back(std::move(bigger));
+            _ring.store(r, std::memory_order_release);
+        }
+
+        r->put(b, j);
+        _bottom.store(b + 1, std::memory_order_release);
+    }
+
+    // owner only
+    job *pop()
+    {
+        int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+        ring   *r = _ring.load(std::memory_order_relaxed);
+        _bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = _top.load(std::memory_order_relaxed);
+
+        if (t > b) { // empty
+            _bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        job *j = r->get(b);
+        if (t == b) {
+            // last item, race against thieves
+            if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                j = nullptr;
+            }
+            _bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return j;
+    }
+
+    // any thread
+    job *steal()
+    {
+        int64_t t = _top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = _bottom.load(std::memory_order_acquire);
+
+        if (t >= b) {
+            return nullptr;
+        }
+
+        ring *r = _ring.load(std::memory_order_acquire);
+        job  *j = r->get(t);
+        if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr; // lost against the owner or another thief
+        }
+        return j;
+    }
+};
+
+} // namespace detail
+
+
+using detail::job;
+
+
+job_handle::job_handle(job *j) : _job(j) {}
+
+job_handle::job_handle(const job_handle &other) : _job(other._job)
+{
+    if (_job) {
+        _job->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+job_handle::~job_handle()
+{
+    if (_job) {
+        detail::release_ref(_job);
+    }
+}
+
+bool job_handle::done() const { return _job && _job->bDone.load(std::memory_order_acquire); }
+
+
+struct job_system::worker
+{
+    detail::work_stealing_deque deque;
+    unsigned                    index = 0;
+    uint32_t                    rng   = 0;
+
+    // written by the owning worker only
+    std::atomic<uint64_t> executed{0};
+    std::atomic<uint64_t> steals{0};
+    std::atomic<uint64_t> failed_steals{0};
+    std::atomic<uint64_t> idle_ns{0};
+};
+
+struct job_system::shared_state
+{
+    std::mutex        inject_mutex;
+    std::deque<job *> injected; // submits from threads that aren't workers
+
+    std::mutex              sleep_mutex;
+    std::condition_variable wake;
+
+    std::atomic<int64_t>  queued{0};      // jobs sitting in a deque or the injection queue
+    std::atomic<int64_t>  outstanding{0}; // submitted and not finished yet
+    std::atomic<uint64_t> helped{0};      // jobs run by threads that aren't workers, while they wait
+    std::atomic<int>      sleepers{0};
+    std::atomic<bool>     bStop{false};
+    std::atomic<bool>     bShutdown{false};
+    std::mutex            shutdown_mutex;
+};
+
+namespace
+{
+struct thread_context
+{
+    job_system       *owner     = nullptr; // set on worker threads
+    void             *self      = nullptr;
+    const job_system *executing = nullptr; // set while any thread runs a job of that system
+};
+thread_local thread_context t_context;
+} // namespace
+
+
+job_system::job_system(unsigned worker_count)
+    : _state(new shared_state)
+{
+    // the pool must outlive the global scheduler, whose workers still recycle jobs on exit
+    detail::job_pool::instance();
+
+    for (unsigned i = 0; i < worker_count; ++i) {
+        auto *w  = new worker;
+        w->index = i;
+        w->rng   = 0x9e3779b9u * (i + 1);
+        _worker_data.push_back(w);
+    }
+
+    for (unsigned i = 0; i < worker_count; ++i) {
+        _workers.emplace_back([this, w = _worker_data[i]]() {
+            t_context.owner = this;
+            t_context.self  = w;
+
+            while (true) {
+                if (job *j = find_job(w)) {
+                    execute(j);
+                    continue;
+                }
+                if (_state->bStop.load(std::memory_order_acquire)) {
+                    break;
+                }
+
+                auto t0 = std::chrono::steady_clock::now();
+                idle_wait([this]() {
+                    return _state->queued.load() > 0 || _state->bStop.load();
+                });
+                auto dt = std::chrono::steady_clock::now() - t0;
+                w->idle_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(dt).count(), std::memory_order_relaxed);
+            }
+        });
+    }
+}
+
+job_system::~job_system()
+{
+    shutdown();
+    for (worker *w : _worker_data) {
+        delete w;
+    }
+    delete _state;
+}
+
+job_system &job_system::global()
+{
+    static job_system system(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return system;
+}
+
+
+job_handle job_system::submit(std::function<void()> fn, std::span<const job_handle> dependencies)
+{
+    // counted first, so shutdown() either rejects this submit or waits for the job
+    _state->outstanding.fetch_add(1);
+    if (_state->bShutdown.load() && t_context.owner != this && t_context.executing != this) {
+        _state->outstanding.fetch_sub(1);
+        throw std::runtime_error("job_system is shut down");
+    }
+
+    job *j = detail::job_pool::instance().acquire();
+    j->fn  = std::move(fn);
+    j->refs.store(2, std::memory_order_relaxed); // scheduler + the returned handle
+    j->pending.store(static_cast<int>(dependencies.size()) + 1, std::memory_order_relaxed);
+
+    for (const job_handle &dep : dependencies) {
+        job *d = dep._job;
+        if (d) {
+            d->lock_continuations();
+            if (!d->bDone.load(std::memory_order_acquire)) {
+                d->continuations.push_back(j);
+                d->unlock_continuations();
+                continue;
+            }
+            d->unlock_continuations();
+        }
+        j->pending.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    if (j->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        schedule(j);
+    }
+    return job_handle(j);
+}
+
+void job_system::schedule(job *j)
+{
+    _state->queued.fetch_add(1);
+
+    if (t_context.owner == this) {
+        static_cast<worker *>(t_context.self)->deque.push(j);
+    }
+    else {
+        std::lock_guard lock(_state->inject_mutex);
+        _state->injected.push_back(j);
+    }
+
+    if (_state->sleepers.load() > 0) {
+        { // pairs with the predicate check in idle_wait, no lost wake up
+            std::lock_guard lock(_state->sleep_mutex);
+        }
+        _state->wake.notify_one();
+    }
+}
+
+job *job_system::find_job(worker *self)
+{
+    if (_state->queued.load(std::memory_order_relaxed) <= 0) {
+        return nullptr;
+    }
+
+    job *j = nullptr;
+    if (self) {
+        j = self->deque.pop();
+    }
+
+    if (!j) {
+        std::lock_guard lock(_state->inject_mutex);
+        if (!_state->injected.empty()) {
+            j = _state->injected.front();
+            _state->injected.pop_front();
+        }
+    }
+
+    if (!j && !_worker_data.empty()) {
+        // start at a random victim, so thieves don't all hammer worker 0
+        uint32_t start = 0;
+        if (self) {
+            self->rng ^= self->rng << 13;
+            self->rng ^= self->rng >> 17;
+            self->rng ^= self->rng << 5;
+            start = self->rng;
+        }
+        else {
+            start = static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+        }
+
+        const size_t n = _worker_data.size();
+        for (size_t k = 0; k < n && !j; ++k) {
+            worker *victim = _worker_data[(start + k) % n];
+            if (victim == self) {
+                continue;
+            }
+            j = victim->deque.steal();
+            if (self) {
+                (j ? self->steals : self->failed_steals).fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    if (j) {
+        _state->queued.fetch_sub(1);
+    }
+    return j;
+}
+
+void job_system::execute(job *j)
+{
+    const job_system *prev = t_context.executing;
+    t_context.executing    = this;
+    try {
+        j->fn();
+    }
+    catch (...) {
+        j->error = std::current_exception();
+    }
+    t_context.executing = prev;
+
+    if (t_context.owner == this) {
+        static_cast<worker *>(t_context.self)->executed.fetch_add(1, std::memory_order_relaxed);
+    }
+    else {
+        _state->helped.fetch_add(1, std::memory_order_relaxed);
+    }
+    finish(j);
+}
+
+void job_system::finish(job *j)
+{
+    j->lock_continuations();
+    j->bDone.store(true);
+    j->unlock_continuations();
+
+    // nobody appends after bDone, no lock needed to walk the list
+    for (job *c : j->continuations) {
+        if (c->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            schedule(c);
+        }
+    }
+
+    bool bNotify = j->waiters.load() > 0;
+    if (_state->outstanding.fetch_sub(1) == 1) {
+        bNotify |= _state->bShutdown.load(); // shutdown() is draining
+    }
+    if (bNotify) {
+        {
+            std::lock_guard lock(_state->sleep_mutex);
+        }
+        _state->wake.notify_all();
+    }
+
+    detail::release_ref(j);
+}
+
+template <typename Pred>
+void job_system::idle_wait(Pred &&pred)
+{
+    // spin a little before paying for a sleep, work often shows up right away
+    for (int i = 0; i < 64; ++i) {
+        if (pred()) {
+            return;
+        }
+        std::this_thread::yield();
+    }
+
+    std::unique_lock lock(_state->sleep_mutex);
+    _state->sleepers.fetch_add(1);
+    _state->wake.wait(lock, pred);
+    _state->sleepers.fetch_sub(1);
+}
+
+void job_system::wait(const job_handle &handle)
+{
+    job *j = handle._job;
+    if (!j) {
+        return;
+    }
+
+    worker *self = t_context.owner == this ? static_cast<worker *>(t_context.self) : nullptr;
+    while (!j->bDone.load(std::memory_order_acquire)) {
+        if (job *other = find_job(self)) {
+            execute(other);
+            continue;
+        }
+
+        j->waiters.fetch_add(1);
+        idle_wait([this, j]() {
+            return j->bDone.load() || _state->queued.load() > 0 || _state->bStop.load();
+        });
+        j->waiters.fetch_sub(1);
+    }
+
+    if (j->error) {
+        std::rethrow_exception(j->error);
+    }
+}
+
+void job_system::parallel(size_t count, const std::function<void(size_t)> &task, unsigned max_threads)
+{
+    if (count == 0) {
+        return;
+    }
+
+    struct batch
+    {
+        const std::function<void(size_t)> &task;
+        size_t                             count;
+        std::atomic<size_t>                next{0};
+        std::atomic<bool>                  bFailed{false};
+
+        // returns after there is nothing left to take, helpers that start late return at once
+        void work()
+        {
+            size_t i;
+            while ((i = next.fetch_add(1, std::memory_order_relaxed)) < count) {
+                if (bFailed.load(std::memory_order_relaxed)) {
+                    continue; // skip the remaining chunks once something failed
+                }
+                try {
+                    task(i);
+                }
+                catch (...) {
+                    bFailed.store(true, std::memory_order_relaxed);
+                    throw;
+                }
+            }
+        }
+    } b{task, count};
+
+    unsigned helpers = static_cast<unsigned>(_workers.size());
+    if (max_threads > 0) {
+        helpers = std::min(helpers, max_threads - 1);
+    }
+    helpers = static_cast<unsigned>(std::min<size_t>(helpers, count - 1));
+
+    std::vector<job_handle> jobs;
+    jobs.reserve(helpers);
+    for (unsigned i = 0; i < helpers; ++i) {
+        jobs.push_back(submit([&b]() { b.work(); }));
+    }
+
+    std::exception_ptr error;
+    try {
+        b.work();
+    }
+    catch (...) {
+        error = std::current_exception();
+    }
+
+    // every helper must be done before `b` goes out of scope
+    for (auto &h : jobs) {
+        try {
+            wait(h);
+        }
+        catch (...) {
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void job_system::shutdown()
+{
+    std::lock_guard guard(_state->shutdown_mutex);
+    if (_workers.empty() && _state->bStop.load()) {
+        return;
+    }
+    if (t_context.owner == this || t_context.executing == this) {
+        throw std::logic_error("job_system::shutdown() called from one of its own jobs");
+    }
+
+    _state->bShutdown.store(true);
+
+    // drain, this thread helps like in wait()
+    while (_state->outstanding.load() > 0) {
+        if (job *j = find_job(nullptr)) {
+            execute(j);
+            continue;
+        }
+        idle_wait([this]() {
+            return _state->outstanding.load() == 0 || _state->queued.load() > 0;
+        });
+    }
+
+    {
+        std::lock_guard lock(_state->sleep_mutex);
+        _state->bStop.store(true);
+    }
+    _state->wake.notify_all();
+
+    for (auto &t : _workers) {
+        t.join();
+    }
+    _workers.clear();
+}
+
+job_system::stats job_system::statistics() const
+{
+    stats total;
+    total.executed = _state->helped.load(std::memory_order_relaxed);
+    for (const auto &s : worker_statistics()) {
+        total.executed += s.executed;
+        total.steals += s.steals;
+        total.failed_steals += s.failed_steals;
+        total.idle_ns += s.idle_ns;
+    }
+    return total;
+}
+
+std::vector<job_system::stats> job_system::worker_statistics() const
+{
+    std::vector<stats> ret;
+    ret.reserve(_worker_data.size());
+    for (const worker *w : _worker_data) {
+        ret.push_back(stats{
+            .executed      = w->executed.load(std::memory_order_relaxed),
+            .steals        = w->steals.load(std::memory_order_relaxed),
+            .failed_steals = w->failed_steals.load(std::memory_order_relaxed),
+            .idle_ns       = w->idle_ns.load(std::memory_order_relaxed),
+        });
+    }
+    return ret;
+}
+
+} // namespace ut
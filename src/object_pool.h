@@ -5,15 +5,18 @@
 #include <stdexcept>
 #include <vector>
 
+#include "include/utility.cc/alloc_tracker.h"
+#include "include/utility.cc/small_vector.h"
+
 
 
 template <typename T>
 struct ObjectPool
 {
-    std::vector<T *> _allObjects;
-    std::queue<T *>  _availableObjects;
-    size_t           initialSize = 5;
-    size_t           maxSize     = 20;
+    ut::small_vector<T *, 8> _allObjects; // inline up to the default initialSize with room to grow
+    std::queue<T *>          _availableObjects;
+    size_t                   initialSize = 5;
+    size_t                   maxSize     = 20;
 
     ~ObjectPool()
     {
@@ -28,6 +31,7 @@ struct ObjectPool
 
     T *acquire()
     {
+        UT_ALLOC_SCOPE("ObjectPool::acquire");
         if (!_availableObjects.empty()) {
             T *obj = _availableObjects.front();
             _availableObjects.pop();
@@ -0,0 +1,325 @@
+#include "utility.cc/rope.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#if _WIN32
+    #include <fstream>
+#else
+    #include <cerrno>
+    #include <climits>
+    #include <fcntl.h>
+    #include <sys/uio.h>
+    #include <unistd.h>
+#endif
+
+#include "debug.h"
+
+
+namespace ut
+{
+
+rope::rope() = default;
+rope::~rope() = default;
+
+// spelled out so the moved-from rope doesn't keep writing into a block it no longer owns
+rope::rope(rope &&other) noexcept
+    : _leaves(std::move(other._leaves)),
+      _size(std::exchange(other._size, 0)),
+      _blocks(std::move(other._blocks)),
+      _block_pos(std::exchange(other._block_pos, nullptr)),
+      _block_left(std::exchange(other._block_left, 0))
+{
+    other._leaves.clear();
+    other._blocks.clear();
+}
+
+rope &rope::operator=(rope &&other) noexcept
+{
+    if (this != &other) {
+        _leaves     = std::move(other._leaves);
+        _size       = std::exchange(other._size, 0);
+        _blocks     = std::move(other._blocks);
+        _block_pos  = std::exchange(other._block_pos, nullptr);
+        _block_left = std::exchange(other._block_left, 0);
+        other._leaves.clear();
+        other._blocks.clear();
+    }
+    return *this;
+}
+
+
+std::string_view rope::copy(std::string_view text)
+{
+    if (text.size() > block_size / 4) {
+        // big pieces get a block of their own, the current block keeps filling up
+        _blocks.push_back(std::make_unique_for_overwrite<char[]>(text.size()));
+        std::memcpy(_blocks.back().get(), text.data(), text.size());
+        return {_blocks.back().get(), text.size()};
+    }
+    if (text.size() > _block_left) {
+        _blocks.push_back(std::make_unique_for_overwrite<char[]>(block_size));
+        _block_pos  = _blocks.back().get();
+        _block_left = block_size;
+    }
+    std::memcpy(_block_pos, text.data(), text.size());
+    std::string_view ret(_block_pos, text.size());
+    _block_pos += text.size();
+    _block_left -= text.size();
+    return ret;
+}
+
+rope &rope::append(std::string_view text)
+{
+    if (!text.empty()) {
+        insert_piece(_size, copy(text));
+    }
+    return *this;
+}
+
+rope &rope::borrow(std::string_view text)
+{
+    insert_piece(_size, text);
+    return *this;
+}
+
+void rope::insert(size_t offset, std::string_view text)
+{
+    if (!text.empty()) {
+        insert_piece(offset, copy(text));
+    }
+}
+
+void rope::insert_borrowed(size_t offset, std::string_view text)
+{
+    insert_piece(offset, text);
+}
+
+void rope::insert_piece(size_t offset, std::string_view piece)
+{
+    if (piece.empty()) {
+        return;
+    }
+    offset = std::min(offset, _size);
+
+    if (offset == _size) {
+        if (_leaves.empty() || _leaves.back().pieces.size() >= max_pieces) {
+            _leaves.emplace_back();
+        }
+        leaf &last = _leaves.back();
+        if (!last.pieces.empty() && last.pieces.back().data() + last.pieces.back().size() == piece.data()) {
+            last.pieces.back() = std::string_view(last.pieces.back().data(), last.pieces.back().size() + piece.size());
+        }
+        else {
+            last.pieces.push_back(piece);
+        }
+        last.bytes += piece.size();
+        _size += piece.size();
+        return;
+    }
+
+    position pos = split_at(offset);
+    leaf    &l   = _leaves[pos.leaf];
+    l.pieces.insert(l.pieces.begin() + static_cast<std::ptrdiff_t>(pos.piece), piece);
+    l.bytes += piece.size();
+    _size += piece.size();
+    if (l.pieces.size() > max_pieces) {
+        split_leaf(pos.leaf);
+    }
+}
+
+rope::position rope::split_at(size_t offset)
+{
+    if (_leaves.empty()) {
+        _leaves.emplace_back();
+    }
+    size_t li = 0;
+    while (li + 1 < _leaves.size() && offset > _leaves[li].bytes) {
+        offset -= _leaves[li].bytes;
+        ++li;
+    }
+
+    leaf &l = _leaves[li];
+    for (size_t pi = 0; pi < l.pieces.size(); ++pi) {
+        if (offset == 0) {
+            return {li, pi};
+        }
+        const std::string_view piece = l.pieces[pi];
+        if (offset < piece.size()) {
+            l.pieces[pi] = piece.substr(0, offset);
+            l.pieces.insert(l.pieces.begin() + static_cast<std::ptrdiff_t>(pi) + 1, piece.substr(offset));
+            return {li, pi + 1};
+        }
+        offset -= piece.size();
+    }
+    return {li, l.pieces.size()};
+}
+
+void rope::split_leaf(size_t index)
+{
+    leaf        &l    = _leaves[index];
+    const size_t half = l.pieces.size() / 2;
+
+    leaf upper;
+    upper.pieces.assign(l.pieces.begin() + static_cast<std::ptrdiff_t>(half), l.pieces.end());
+    l.pieces.resize(half);
+    for (std::string_view piece : upper.pieces) {
+        upper.bytes += piece.size();
+    }
+    l.bytes -= upper.bytes;
+    _leaves.insert(_leaves.begin() + static_cast<std::ptrdiff_t>(index) + 1, std::move(upper));
+}
+
+void rope::erase(size_t offset, size_t count)
+{
+    offset = std::min(offset, _size);
+    count  = std::min(count, _size - offset);
+    if (count == 0) {
+        return;
+    }
+
+    split_at(offset + count);
+    const position first = split_at(offset);
+
+    // whole pieces from `first` on, the boundaries above guarantee none straddles the end
+    size_t remaining = count;
+    size_t li        = first.leaf;
+    size_t pi        = first.piece;
+    while (remaining) {
+        leaf &l = _leaves[li];
+        if (pi == l.pieces.size()) {
+            ++li;
+            pi = 0;
+            continue;
+        }
+        const size_t n = l.pieces[pi].size();
+        l.pieces.erase(l.pieces.begin() + static_cast<std::ptrdiff_t>(pi));
+        l.bytes -= n;
+        remaining -= n;
+    }
+    _size -= count;
+
+    std::erase_if(_leaves, [](const leaf &l) { return l.pieces.empty(); });
+    // the two splits can leave one leaf a piece over the limit
+    for (size_t i = first.leaf; i < std::min(li + 1, _leaves.size()); ++i) {
+        if (_leaves[i].pieces.size() > max_pieces) {
+            split_leaf(i);
+        }
+    }
+}
+
+void rope::replace(size_t offset, size_t count, std::string_view text)
+{
+    erase(offset, count);
+    insert(offset, text);
+}
+
+void rope::clear()
+{
+    _leaves.clear();
+    _size = 0;
+    _blocks.clear();
+    _block_pos  = nullptr;
+    _block_left = 0;
+}
+
+size_t rope::piece_count() const
+{
+    size_t n = 0;
+    for (const leaf &l : _leaves) {
+        n += l.pieces.size();
+    }
+    return n;
+}
+
+char rope::at(size_t offset) const
+{
+    for (const leaf &l : _leaves) {
+        if (offset >= l.bytes) {
+            offset -= l.bytes;
+            continue;
+        }
+        for (std::string_view piece : l.pieces) {
+            if (offset < piece.size()) {
+                return piece[offset];
+            }
+            offset -= piece.size();
+        }
+    }
+    return '\0';
+}
+
+std::string rope::flatten() const
+{
+    std::string ret;
+    flatten_into(ret);
+    return ret;
+}
+
+void rope::flatten_into(std::string &out) const
+{
+    out.reserve(out.size() + _size);
+    for_each_piece([&](std::string_view piece) { out.append(piece); });
+}
+
+bool rope::write_to(const std::filesystem::path &filepath) const
+{
+#if _WIN32
+    std::ofstream f(filepath, std::ios::binary | std::ios::trunc);
+    for_each_piece([&](std::string_view piece) { f.write(piece.data(), static_cast<std::streamsize>(piece.size())); });
+    if (!f.flush()) {
+        log(), "Failed to write file: ", filepath;
+        return false;
+    }
+    return true;
+#else
+    int fd = ::open(filepath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        log(), "Failed to open file: ", filepath;
+        return false;
+    }
+
+    #ifdef IOV_MAX
+    constexpr size_t batch = IOV_MAX;
+    #else
+    constexpr size_t batch = 1024;
+    #endif
+
+    std::vector<iovec> iov;
+    iov.reserve(piece_count());
+    for_each_piece([&](std::string_view piece) { iov.push_back(iovec{const_cast<char *>(piece.data()), piece.size()}); });
+
+    bool   bOk = true;
+    size_t i   = 0;
+    while (i < iov.size()) {
+        ssize_t written = ::writev(fd, &iov[i], static_cast<int>(std::min(batch, iov.size() - i)));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            bOk = false;
+            break;
+        }
+        // skip what was written, a short write leaves the rest of a piece for the next call
+        size_t left = static_cast<size_t>(written);
+        while (i < iov.size() && left >= iov[i].iov_len) {
+            left -= iov[i].iov_len;
+            ++i;
+        }
+        if (left) {
+            iov[i].iov_base = static_cast<char *>(iov[i].iov_base) + left;
+            iov[i].iov_len -= left;
+        }
+    }
+    if (::close(fd) != 0) {
+        bOk = false;
+    }
+    if (!bOk) {
+        log(), "Failed to write file: ", filepath;
+    }
+    return bOk;
+#endif
+}
+
+} // namespace ut
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define UT_SIMD_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define UT_SIMD_NEON 1
+#endif
+
+// internal helpers shared by the scanners in src/, not part of the public headers
+
+namespace ut::simd
+{
+
+/**
+ * One 64 byte block, loaded once and compared against several characters.
+ * Bit i of a mask is set when byte i matches.
+ */
+struct block64
+{
+#if UT_SIMD_SSE2
+    __m128i v[4];
+
+    explicit block64(const char *p)
+    {
+        for (int i = 0; i < 4; ++i) {
+            v[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i * 16));
+        }
+    }
+
+    uint64_t eq(char c) const
+    {
+        const __m128i needle = _mm_set1_epi8(c);
+        uint64_t      mask   = 0;
+        for (int i = 0; i < 4; ++i) {
+            mask |= uint64_t(uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v[i], needle)))) << (i * 16);
+        }
+        return mask;
+    }
+#elif UT_SIMD_NEON
+    uint8x16_t v[4];
+
+    explicit block64(const char *p)
+    {
+        for (int i = 0; i < 4; ++i) {
+            v[i] = vld1q_u8(reinterpret_cast<const uint8_t *>(p + i * 16));
+        }
+    }
+
+    uint64_t eq(char c) const
+    {
+        // weight each lane by its bit, then pairwise add down to 8 bytes (simdjson's movemask)
+        const uint8x16_t needle = vdupq_n_u8(static_cast<uint8_t>(c));
+        const uint8x16_t weight = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+
+        uint8x16_t t[4];
+        for (int i = 0; i < 4; ++i) {
+            t[i] = vandq_u8(vceqq_u8(v[i], needle), weight);
+        }
+        uint8x16_t sum = vpaddq_u8(vpaddq_u8(t[0], t[1]), vpaddq_u8(t[2], t[3]));
+        sum            = vpaddq_u8(sum, sum);
+        return vgetq_lane_u64(vreinterpretq_u64_u8(sum), 0);
+    }
+#else
+    const char *p;
+
+    explicit block64(const char *p) : p(p) {}
+
+    uint64_t eq(char c) const
+    {
+        uint64_t mask = 0;
+        for (int i = 0; i < 64; ++i) {
+            mask |= uint64_t(p[i] == c) << i;
+        }
+        return mask;
+    }
+#endif
+};
+
+/**
+ * Whether any start position p..p+63 passes any of the filters (p[o1] == c1 && p[o2] == c2),
+ *  Filter being any struct with those four members.
+ * One reduction for the whole set, so blocks without candidates cost a single movemask.
+ */
+template <typename Filter>
+inline bool any_pair(const char *p, const Filter *filters, size_t n)
+{
+#if UT_SIMD_SSE2
+    __m128i acc = _mm_setzero_si128();
+    for (size_t k = 0; k < n; ++k) {
+        const Filter      &f  = filters[k];
+        const __m128i      n1 = _mm_set1_epi8(f.c1);
+        const __m128i      n2 = _mm_set1_epi8(f.c2);
+        for (int i = 0; i < 4; ++i) {
+            acc = _mm_or_si128(acc, _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + f.o1 + i * 16)), n1),
+                                                  _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + f.o2 + i * 16)), n2)));
+        }
+    }
+    return _mm_movemask_epi8(acc) != 0;
+#elif UT_SIMD_NEON
+    uint8x16_t acc = vdupq_n_u8(0);
+    for (size_t k = 0; k < n; ++k) {
+        const Filter      &f  = filters[k];
+        const uint8x16_t   n1 = vdupq_n_u8(static_cast<uint8_t>(f.c1));
+        const uint8x16_t   n2 = vdupq_n_u8(static_cast<uint8_t>(f.c2));
+        for (int i = 0; i < 4; ++i) {
+            acc = vorrq_u8(acc, vandq_u8(vceqq_u8(vld1q_u8(reinterpret_cast<const uint8_t *>(p + f.o1 + i * 16)), n1),
+                                         vceqq_u8(vld1q_u8(reinterpret_cast<const uint8_t *>(p + f.o2 + i * 16)), n2)));
+        }
+    }
+    return vmaxvq_u8(acc) != 0;
+#else
+    for (size_t k = 0; k < n; ++k) {
+        for (int i = 0; i < 64; ++i) {
+            if (p[filters[k].o1 + i] == filters[k].c1 && p[filters[k].o2 + i] == filters[k].c2) {
+                return true;
+            }
+        }
+    }
+    return false;
+#endif
+}
+
+/**
+ * Bit i is set when a[i] == ca and b[i] == cb, for i in 0..63: the candidate filter of substring search.
+ * Both compares are combined before the movemask and an all-zero block returns early, the common case.
+ */
+inline uint64_t eq_pair(const char *a, char ca, const char *b, char cb)
+{
+#if UT_SIMD_SSE2
+    const __m128i na = _mm_set1_epi8(ca);
+    const __m128i nb = _mm_set1_epi8(cb);
+    __m128i       m[4];
+    for (int i = 0; i < 4; ++i) {
+        m[i] = _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i * 16)), na),
+                             _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i * 16)), nb));
+    }
+    if (!_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(m[0], m[1]), _mm_or_si128(m[2], m[3])))) {
+        return 0;
+    }
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; ++i) {
+        mask |= uint64_t(uint32_t(_mm_movemask_epi8(m[i]))) << (i * 16);
+    }
+    return mask;
+#elif UT_SIMD_NEON
+    const uint8x16_t na = vdupq_n_u8(static_cast<uint8_t>(ca));
+    const uint8x16_t nb = vdupq_n_u8(static_cast<uint8_t>(cb));
+    uint8x16_t       any = vdupq_n_u8(0);
+    for (int i = 0; i < 4; ++i) {
+        any = vorrq_u8(any, vandq_u8(vceqq_u8(vld1q_u8(reinterpret_cast<const uint8_t *>(a + i * 16)), na),
+                                     vceqq_u8(vld1q_u8(reinterpret_cast<const uint8_t *>(b + i * 16)), nb)));
+    }
+    if (!vmaxvq_u8(any)) {
+        return 0;
+    }
+    return block64(a).eq(ca) & block64(b).eq(cb);
+#else
+    uint64_t mask = 0;
+    for (int i = 0; i < 64; ++i) {
+        mask |= uint64_t(a[i] == ca && b[i] == cb) << i;
+    }
+    return mask;
+#endif
+}
+
+/**
+ * Bit i of the result is the xor of bits 0..i of x.
+ * With x = quote positions, the result marks everything inside quotes (opening quote included).
+ */
+inline uint64_t prefix_xor(uint64_t x)
+{
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+// copy a tail shorter than 64 bytes into a padded block so block64 never reads past the end
+struct tail_block
+{
+    alignas(64) char bytes[64];
+
+    tail_block(const char *p, size_t n, char pad = '\0')
+    {
+        std::memset(bytes, pad, sizeof(bytes));
+        std::memcpy(bytes, p, n);
+    }
+};
+
+/**
+ * Append base + index of every set bit to out, lowest first, and return the new end.
+ * Stores 8 at a time unconditionally (simdjson style), so out needs 64 slots of room.
+ */
+inline uint32_t *write_bit_positions(uint64_t mask, uint32_t base, uint32_t *out)
+{
+    const int count = std::popcount(mask);
+    for (int i = 0; i < 8; ++i) {
+        out[i] = base + static_cast<uint32_t>(std::countr_zero(mask));
+        mask &= mask - 1;
+    }
+    if (count > 8) {
+        for (int i = 8; i < 16; ++i) {
+            out[i] = base + static_cast<uint32_t>(std::countr_zero(mask));
+            mask &= mask - 1;
+        }
+        for (int i = 16; i < count; ++i) {
+            out[i] = base + static_cast<uint32_t>(std::countr_zero(mask));
+            mask &= mask - 1;
+        }
+    }
+    return out + count;
+}
+
+// calls fn(index) for every set bit, lowest first
+template <typename Fn>
+inline void for_each_bit(uint64_t mask, Fn &&fn)
+{
+    while (mask) {
+        fn(static_cast<size_t>(std::countr_zero(mask)));
+        mask &= mask - 1;
+    }
+}
+
+} // namespace ut::simd
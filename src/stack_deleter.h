@@ -5,6 +5,9 @@
 #include <utility>
 #include <vector>
 
+#include "include/utility.cc/alloc_tracker.h"
+#include "include/utility.cc/small_vector.h"
+
 // 是否需要一份整个声明周期都存在的内存，，来维护一个基于栈的清理操作？？
 // 花一小部分时间来手动管理资源的生命周期，是不是更加合理？？
 
@@ -32,7 +35,8 @@ class StackDeleter
     };
 
   private:
-    std::vector<DeleterItem> _items;
+    // most scopes register a handful of deleters, keep those out of the allocator
+    small_vector<DeleterItem, 4> _items;
 
   public:
 
@@ -40,6 +44,7 @@ class StackDeleter
     template <typename T>
     T *push(const std::string &name, T *handle, std::function<void(void *)> deleter)
     {
+        UT_ALLOC_SCOPE("StackDeleter::push");
 #ifdef UTILITY_DEBUG_ENABLED
         fprintf(stderr, "[StackDeleter] Adding custom deleter %s for management\n", name.c_str());
 #endif
@@ -53,6 +58,7 @@ class StackDeleter
 
     void push(const std::string &name, std::function<void(void *)> deleter)
     {
+        UT_ALLOC_SCOPE("StackDeleter::push");
 #ifdef UTILITY_DEBUG_ENABLED
         fprintf(stderr, "[StackDeleter] Adding custom deleter %s for management\n", name.c_str());
 #endif
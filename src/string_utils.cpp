@@ -8,9 +8,16 @@
  */
 
 #include "utility.cc/string_utils.h"
+#include "utility.cc/alloc_tracker.h"
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cstddef>
+#include <cstring>
 #include <string_view>
 
+#include "simd_utils.h"
+
 
 
 namespace ut
@@ -19,19 +26,227 @@ namespace str
 {
 
 
+namespace
+{
+
+// rough byte frequency of text, lower is more common; anything not listed counts as rare
+constexpr std::array<uint8_t, 256> byte_rank = []() {
+    std::array<uint8_t, 256> rank{};
+    rank.fill(255);
+    constexpr std::string_view common = " etaoinsrhldcumfpgwybvkxjqz"
+                                        "ETAOINSRHLDCUMFPGWYBVKXJQZ"
+                                        "0123456789"
+                                        "\n,.-_/:=\"'()\t\r;<>{}[]";
+    for (size_t i = 0; i < common.size(); ++i) {
+        rank[static_cast<uint8_t>(common[i])] = static_cast<uint8_t>(i);
+    }
+    return rank;
+}();
+
+uint8_t rank_of(char c)
+{
+    return byte_rank[static_cast<uint8_t>(c)];
+}
+
+// offsets of the two rarest bytes of the needle, preferring two different byte values
+void pick_rare(std::string_view needle, uint32_t &rare1, uint32_t &rare2)
+{
+    rare1 = rare2 = 0;
+    for (uint32_t i = 1; i < needle.size(); ++i) {
+        if (rank_of(needle[i]) > rank_of(needle[rare1])) {
+            rare1 = i;
+        }
+    }
+    int best = -1;
+    for (uint32_t i = 0; i < needle.size(); ++i) {
+        if (i == rare1) {
+            continue;
+        }
+        int score = rank_of(needle[i]) + (needle[i] != needle[rare1] ? 256 : 0);
+        if (score > best) {
+            best  = score;
+            rare2 = i;
+        }
+    }
+    if (best < 0) {
+        rare2 = rare1; // single byte needle
+    }
+}
+
+size_t find_filtered(std::string_view haystack, std::string_view needle, size_t pos, uint32_t o1, uint32_t o2)
+{
+    const size_t n = needle.size();
+    if (n == 0) {
+        return pos <= haystack.size() ? pos : std::string_view::npos;
+    }
+    if (pos > haystack.size() || haystack.size() - pos < n) {
+        return std::string_view::npos;
+    }
+
+    const char *data = haystack.data();
+    const char *p    = data + pos;
+    if (n == 1) {
+        const void *hit = std::memchr(p, needle[0], haystack.size() - pos);
+        return hit ? static_cast<const char *>(hit) - data : std::string_view::npos;
+    }
+
+    const char *last = data + haystack.size() - n; // last possible start
+    const char  c1   = needle[o1];
+    const char  c2   = needle[o2];
+
+    // memchr on the rarer filter byte is the fastest skip while its hits are far apart,
+    //  drop to the two byte filter once they come too often (< 256 bytes apart on average)
+    const char *phase     = p;
+    int         false_hit = 0;
+    while (p <= last) {
+        const void *hit = std::memchr(p + o1, c1, static_cast<size_t>(last - p) + 1);
+        if (!hit) {
+            return std::string_view::npos;
+        }
+        const char *candidate = static_cast<const char *>(hit) - o1;
+        if (candidate[o2] == c2 && std::memcmp(candidate, needle.data(), n) == 0) {
+            return candidate - data;
+        }
+        p = candidate + 1;
+        if (++false_hit == 16) {
+            if (p - phase < 16 * 256) {
+                break;
+            }
+            false_hit = 0;
+            phase     = p;
+        }
+    }
+
+    // 64 candidate starts per step, the filter loads end at most at last + n - 1 + 63
+    while (last - p >= 63) {
+        uint64_t mask = simd::eq_pair(p + o1, c1, p + o2, c2);
+        while (mask) {
+            const char *candidate = p + std::countr_zero(mask);
+            if (std::memcmp(candidate, needle.data(), n) == 0) {
+                return candidate - data;
+            }
+            mask &= mask - 1;
+        }
+        p += 64;
+    }
+    for (; p <= last; ++p) {
+        if (p[o1] == c1 && p[o2] == c2 && std::memcmp(p, needle.data(), n) == 0) {
+            return p - data;
+        }
+    }
+    return std::string_view::npos;
+}
+
+} // namespace
+
+
+size_t find(std::string_view haystack, std::string_view needle, size_t pos)
+{
+    return find_filtered(haystack, needle, pos, 0, needle.empty() ? 0 : static_cast<uint32_t>(needle.size() - 1));
+}
+
+searcher::searcher(std::string_view needle) : _needle(needle)
+{
+    pick_rare(_needle, _rare1, _rare2);
+}
+
+size_t searcher::find(std::string_view haystack, size_t pos) const
+{
+    return find_filtered(haystack, _needle, pos, _rare1, _rare2);
+}
+
+
+multi_searcher::multi_searcher(std::span<const std::string_view> patterns)
+{
+    _patterns.reserve(patterns.size());
+    for (std::string_view text : patterns) {
+        if (!text.empty()) {
+            filter f{.o1 = 0, .o2 = 0, .c1 = 0, .c2 = 0, .pattern = static_cast<uint32_t>(_patterns.size())};
+            pick_rare(text, f.o1, f.o2);
+            f.c1 = text[f.o1];
+            f.c2 = text[f.o2];
+            _filters.push_back(f);
+        }
+        _patterns.emplace_back(text);
+        _max_size = std::max(_max_size, text.size());
+    }
+}
+
+std::vector<multi_searcher::match> multi_searcher::find_all(std::string_view haystack) const
+{
+    std::vector<match> ret;
+    find_all(haystack, ret);
+    return ret;
+}
+
+void multi_searcher::find_all(std::string_view haystack, std::vector<match> &out) const
+{
+    const char  *data = haystack.data();
+    const char  *p    = data;
+    const char  *end  = data + haystack.size();
+    const size_t k    = _filters.size();
+
+    auto verify = [&](const char *at, const filter &f) {
+        const std::string &text = _patterns[f.pattern];
+        if (static_cast<size_t>(end - at) >= text.size() && std::memcmp(at, text.data(), text.size()) == 0) {
+            out.push_back(match{.offset = static_cast<size_t>(at - data), .pattern = f.pattern});
+        }
+    };
+
+    // one candidate mask per pattern, positions are visited in order so matches come out sorted
+    small_vector<uint64_t, 16> masks(k);
+    while (end - p >= static_cast<std::ptrdiff_t>(63 + _max_size)) {
+        if (!simd::any_pair(p, _filters.data(), k)) {
+            p += 64;
+            continue;
+        }
+        uint64_t any = 0;
+        for (size_t i = 0; i < k; ++i) {
+            masks[i] = simd::eq_pair(p + _filters[i].o1, _filters[i].c1, p + _filters[i].o2, _filters[i].c2);
+            any |= masks[i];
+        }
+        while (any) {
+            const int bit = std::countr_zero(any);
+            for (size_t i = 0; i < k; ++i) {
+                if (masks[i] >> bit & 1) {
+                    verify(p + bit, _filters[i]);
+                }
+            }
+            any &= any - 1;
+        }
+        p += 64;
+    }
+
+    for (; p < end; ++p) {
+        for (const filter &f : _filters) {
+            if (f.o1 < static_cast<size_t>(end - p) && p[f.o1] == f.c1) {
+                verify(p, f);
+            }
+        }
+    }
+}
+
+
 std::string replace(std::string_view source, std::string_view from, const std::string_view to)
 {
-    std::string ret(source);
-    size_t      pos = 0;
-    while ((pos = ret.find(from, pos)) != std::string::npos) {
-        ret.replace(pos, from.size(), to);
-        pos += to.size();
+    if (from.empty()) {
+        return std::string(source);
     }
+    const searcher s(from);
+    std::string    ret;
+    ret.reserve(source.size());
+    size_t start = 0;
+    for (size_t pos; (pos = s.find(source, start)) != std::string_view::npos; start = pos + from.size()) {
+        ret.append(source.substr(start, pos - start));
+        ret.append(to);
+    }
+    ret.append(source.substr(start));
     return ret;
 }
 
 std::vector<std::string> split(std::string_view source, char delimiter)
 {
+    UT_ALLOC_SCOPE("str::split");
     std::vector<std::string> ret;
     // "abc def"
     while (true) {
@@ -59,14 +274,13 @@ bool split(std::string_view source, char sep, std::string &left, std::string_vie
     return true;
 }
 
-bool left(std::string_view source, char delimiter, std::string_view &left)
+std::string_view left(std::string_view source, std::string_view delimiter)
 {
-    size_t n = source.find_first_of(delimiter);
-    if (n != std::string::npos) {
-        return false;
+    size_t n = find(source, delimiter);
+    if (n == std::string::npos) {
+        return source;
     }
-    left = source.substr(0, n);
-    return true;
+    return source.substr(0, n);
 }
 
 
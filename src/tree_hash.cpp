@@ -0,0 +1,130 @@
+#include "utility.cc/tree_hash.h"
+
+#include <algorithm>
+#include <bit>
+
+#include "utility.cc/file_utils.h"
+#include "xxhash.h"
+
+
+namespace ut
+{
+namespace file
+{
+
+namespace
+{
+
+// splitmix64 finalizer
+uint64_t mix(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    return x;
+}
+
+// distinct constants keep leaves, parents and the root from ever being confused with each other
+uint64_t leaf(size_t index, std::string_view bytes)
+{
+    return mix(xxhash::hash64(bytes) ^ mix(static_cast<uint64_t>(index) ^ 0x6C656166ull));
+}
+
+uint64_t parent(uint64_t left, uint64_t right)
+{
+    return mix(left ^ std::rotl(mix(right ^ 0x706172656E74ull), 1));
+}
+
+uint64_t finish(uint64_t top, uint64_t size)
+{
+    return mix(top ^ mix(size ^ 0x726F6F74ull));
+}
+
+} // namespace
+
+
+tree_hash tree_hash::of(std::string_view data)
+{
+    return of(data, options{});
+}
+
+tree_hash tree_hash::of(std::string_view data, options opt)
+{
+    tree_hash t;
+    t.build(data, opt);
+    return t;
+}
+
+std::optional<tree_hash> tree_hash::of_file(const std::filesystem::path &filepath)
+{
+    return of_file(filepath, options{});
+}
+
+std::optional<tree_hash> tree_hash::of_file(const std::filesystem::path &filepath, options opt)
+{
+    auto mapping = mapped_file::open(filepath);
+    if (!mapping) {
+        return std::nullopt;
+    }
+    return of(mapping->view(), opt);
+}
+
+void tree_hash::build(std::string_view data, const options &opt)
+{
+    _chunk_size = opt.chunk_size ? opt.chunk_size : 1;
+    _size       = data.size();
+
+    const size_t chunks = data.empty() ? 1 : (data.size() + _chunk_size - 1) / _chunk_size;
+    _levels.assign(1, std::vector<uint64_t>(chunks));
+    auto &leaves = _levels.front();
+    parallel_for(
+        0, chunks, [&](size_t i) { leaves[i] = leaf(i, data.substr(i * _chunk_size, _chunk_size)); }, opt.parallel);
+
+    while (_levels.back().size() > 1) {
+        const auto           &below = _levels.back();
+        std::vector<uint64_t> above((below.size() + 1) / 2);
+        for (size_t i = 0; i < above.size(); ++i) {
+            above[i] = 2 * i + 1 < below.size() ? parent(below[2 * i], below[2 * i + 1]) : below[2 * i];
+        }
+        _levels.push_back(std::move(above));
+    }
+    _root = finish(_levels.back().front(), _size);
+}
+
+size_t tree_hash::chunk_length(size_t index) const
+{
+    if (index >= chunk_count()) {
+        return 0;
+    }
+    return static_cast<size_t>(std::min<uint64_t>(_chunk_size, _size - chunk_offset(index)));
+}
+
+bool tree_hash::verify_chunk(size_t index, std::string_view bytes) const
+{
+    return index < chunk_count() && bytes.size() == chunk_length(index) && leaf(index, bytes) == chunk(index);
+}
+
+bool tree_hash::update_chunk(size_t index, std::string_view bytes)
+{
+    if (index >= chunk_count() || bytes.size() != chunk_length(index)) {
+        return false;
+    }
+    _levels.front()[index] = leaf(index, bytes);
+    rehash_from(index);
+    return true;
+}
+
+void tree_hash::rehash_from(size_t index)
+{
+    for (size_t level = 1; level < _levels.size(); ++level) {
+        const auto &below = _levels[level - 1];
+        index /= 2;
+        _levels[level][index] = 2 * index + 1 < below.size() ? parent(below[2 * index], below[2 * index + 1]) : below[2 * index];
+    }
+    _root = finish(_levels.back().front(), _size);
+}
+
+} // namespace file
+} // namespace ut
@@ -0,0 +1,537 @@
+#include "utility.cc/utf.h"
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#include "simd_utils.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define UT_UTF_X86 1
+    #include <tmmintrin.h>
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+        #define UT_TARGET_SSSE3
+    #else
+        #define UT_TARGET_SSSE3 __attribute__((target("ssse3")))
+    #endif
+#endif
+
+
+namespace ut
+{
+namespace utf
+{
+
+namespace
+{
+
+/*
+scalar decoder: the reference, the fallback and the slow path of the transcoders
+*/
+
+// length (1..4) of the valid sequence at p, 0 if it is invalid or cut off by the end
+size_t decode(const unsigned char *p, size_t n, char32_t &cp)
+{
+    const unsigned char b0 = p[0];
+    auto cont              = [&](size_t i, unsigned char lo = 0x80, unsigned char hi = 0xBF) { return i < n && p[i] >= lo && p[i] <= hi; };
+
+    if (b0 < 0x80) {
+        cp = b0;
+        return 1;
+    }
+    if (b0 < 0xC2) {
+        return 0; // continuation byte or overlong 2 byte lead
+    }
+    if (b0 < 0xE0) {
+        if (!cont(1)) {
+            return 0;
+        }
+        cp = char32_t(b0 & 0x1F) << 6 | (p[1] & 0x3F);
+        return 2;
+    }
+    if (b0 < 0xF0) {
+        // E0 needs A0.. (no overlong), ED stops at 9F (no surrogates)
+        if (!cont(1, b0 == 0xE0 ? 0xA0 : 0x80, b0 == 0xED ? 0x9F : 0xBF) || !cont(2)) {
+            return 0;
+        }
+        cp = char32_t(b0 & 0x0F) << 12 | char32_t(p[1] & 0x3F) << 6 | (p[2] & 0x3F);
+        return 3;
+    }
+    if (b0 < 0xF5) {
+        // F0 needs 90.. (no overlong), F4 stops at 8F (<= U+10FFFF)
+        if (!cont(1, b0 == 0xF0 ? 0x90 : 0x80, b0 == 0xF4 ? 0x8F : 0xBF) || !cont(2) || !cont(3)) {
+            return 0;
+        }
+        cp = char32_t(b0 & 0x07) << 18 | char32_t(p[1] & 0x3F) << 12 | char32_t(p[2] & 0x3F) << 6 | (p[3] & 0x3F);
+        return 4;
+    }
+    return 0;
+}
+
+// decode for input already validated: the lead byte alone gives the length
+inline size_t decode_valid(const unsigned char *p, char32_t &cp)
+{
+    const unsigned char b0 = p[0];
+    if (b0 < 0x80) {
+        cp = b0;
+        return 1;
+    }
+    if (b0 < 0xE0) {
+        cp = char32_t(b0 & 0x1F) << 6 | (p[1] & 0x3F);
+        return 2;
+    }
+    if (b0 < 0xF0) {
+        cp = char32_t(b0 & 0x0F) << 12 | char32_t(p[1] & 0x3F) << 6 | (p[2] & 0x3F);
+        return 3;
+    }
+    cp = char32_t(b0 & 0x07) << 18 | char32_t(p[1] & 0x3F) << 12 | char32_t(p[2] & 0x3F) << 6 | (p[3] & 0x3F);
+    return 4;
+}
+
+size_t scalar_valid_prefix(const unsigned char *p, size_t n)
+{
+    size_t i = 0;
+    while (i < n) {
+        if (n - i >= 8) {
+            uint64_t word;
+            std::memcpy(&word, p + i, 8);
+            if (!(word & 0x8080808080808080)) {
+                i += 8;
+                continue;
+            }
+        }
+        char32_t cp;
+        size_t   len = decode(p + i, n - i, cp);
+        if (!len) {
+            return i;
+        }
+        i += len;
+    }
+    return n;
+}
+
+char *encode(char32_t cp, char *o)
+{
+    if (cp < 0x80) {
+        *o++ = static_cast<char>(cp);
+    }
+    else if (cp < 0x800) {
+        *o++ = static_cast<char>(0xC0 | cp >> 6);
+        *o++ = static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000) {
+        *o++ = static_cast<char>(0xE0 | cp >> 12);
+        *o++ = static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+        *o++ = static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else {
+        *o++ = static_cast<char>(0xF0 | cp >> 18);
+        *o++ = static_cast<char>(0x80 | (cp >> 12 & 0x3F));
+        *o++ = static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+        *o++ = static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    return o;
+}
+
+
+/*
+lookup table validation: every pair of adjacent bytes is classified by three 16 entry tables
+(high nibble of the first byte, low nibble of the first byte, high nibble of the second byte);
+the AND of the three lookups is non-zero exactly for the invalid pairs, 3rd/4th continuation bytes are checked separately
+*/
+
+constexpr uint8_t TOO_SHORT      = 1 << 0; // 11______ 0_______ or 11______ 11______
+constexpr uint8_t TOO_LONG       = 1 << 1; // 0_______ 10______
+constexpr uint8_t OVERLONG_3     = 1 << 2; // 11100000 100_____
+constexpr uint8_t TOO_LARGE      = 1 << 3; // 11110100 1001____ and above
+constexpr uint8_t SURROGATE      = 1 << 4; // 11101101 101_____
+constexpr uint8_t OVERLONG_2     = 1 << 5; // 1100000_ 10______
+constexpr uint8_t TOO_LARGE_1000 = 1 << 6; // 11110101 1000____ and above
+constexpr uint8_t OVERLONG_4     = 1 << 6; // 11110000 1000____
+constexpr uint8_t TWO_CONTS      = 1 << 7; // 10______ 10______, fine when the lead byte is 2 or 3 back
+constexpr uint8_t CARRY          = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+constexpr uint8_t byte_1_high[16] = {
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, // 0_______ ASCII
+    TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,                                     // 10______ continuation
+    TOO_SHORT | OVERLONG_2,                                                         // 1100____
+    TOO_SHORT,                                                                      // 1101____
+    TOO_SHORT | OVERLONG_3 | SURROGATE,                                             // 1110____
+    TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,                            // 1111____
+};
+
+constexpr uint8_t byte_1_low[16] = {
+    CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4, // ____0000
+    CARRY | OVERLONG_2,                           // ____0001
+    CARRY,
+    CARRY,
+    CARRY | TOO_LARGE,                  // ____0100
+    CARRY | TOO_LARGE | TOO_LARGE_1000, // ____0101
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE, // ____1101
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+};
+
+constexpr uint8_t byte_2_high[16] = {
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, // ________ 0_______
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,           // ________ 1000____
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,                             // ________ 1001____
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,                              // ________ 101_____
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, // ________ 11______
+};
+
+// a lead byte this close to the end of a block still needs bytes from the next one
+constexpr uint8_t incomplete_max[16] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                                        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xEF, 0xDF, 0xBF};
+
+#if UT_UTF_X86
+
+bool has_ssse3()
+{
+    #if defined(__SSSE3__)
+    return true;
+    #elif defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    return info[2] & (1 << 9);
+    #else
+    return __builtin_cpu_supports("ssse3");
+    #endif
+}
+
+UT_TARGET_SSSE3 inline __m128i load_table(const uint8_t (&table)[16])
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(table));
+}
+
+UT_TARGET_SSSE3 inline __m128i high_nibbles(__m128i v)
+{
+    return _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0F));
+}
+
+// non-zero bytes where input (preceded by prev) has an error
+UT_TARGET_SSSE3 inline __m128i block_errors(__m128i input, __m128i prev, __m128i t1h, __m128i t1l, __m128i t2h)
+{
+    const __m128i prev1 = _mm_alignr_epi8(input, prev, 15);
+    const __m128i special =
+        _mm_and_si128(_mm_and_si128(_mm_shuffle_epi8(t1h, high_nibbles(prev1)), _mm_shuffle_epi8(t1l, _mm_and_si128(prev1, _mm_set1_epi8(0x0F)))),
+                      _mm_shuffle_epi8(t2h, high_nibbles(input)));
+
+    // 2 or 3 bytes after a 3/4 byte lead a continuation is required: those are the TWO_CONTS that are fine
+    const __m128i prev2     = _mm_alignr_epi8(input, prev, 14);
+    const __m128i prev3     = _mm_alignr_epi8(input, prev, 13);
+    const __m128i is_third  = _mm_subs_epu8(prev2, _mm_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+    const __m128i is_fourth = _mm_subs_epu8(prev3, _mm_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+    const __m128i must23    = _mm_and_si128(_mm_or_si128(is_third, is_fourth), _mm_set1_epi8(static_cast<char>(0x80)));
+    return _mm_xor_si128(must23, special);
+}
+
+struct ssse3_state
+{
+    __m128i error, prev, incomplete;
+};
+
+UT_TARGET_SSSE3 inline void validate_block(const char *p, bool bCheckAscii, ssse3_state &s)
+{
+    const __m128i t1h = load_table(byte_1_high);
+    const __m128i t1l = load_table(byte_1_low);
+    const __m128i t2h = load_table(byte_2_high);
+
+    __m128i v[4];
+    for (int i = 0; i < 4; ++i) {
+        v[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i * 16));
+    }
+    if (bCheckAscii && !_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(v[0], v[1]), _mm_or_si128(v[2], v[3])))) {
+        // all ASCII: only a sequence left open by the previous block can be wrong
+        s.error      = _mm_or_si128(s.error, s.incomplete);
+        s.incomplete = _mm_setzero_si128();
+    }
+    else {
+        s.error      = _mm_or_si128(s.error, block_errors(v[0], s.prev, t1h, t1l, t2h));
+        s.error      = _mm_or_si128(s.error, block_errors(v[1], v[0], t1h, t1l, t2h));
+        s.error      = _mm_or_si128(s.error, block_errors(v[2], v[1], t1h, t1l, t2h));
+        s.error      = _mm_or_si128(s.error, block_errors(v[3], v[2], t1h, t1l, t2h));
+        s.incomplete = _mm_subs_epu8(v[3], load_table(incomplete_max));
+    }
+    s.prev = v[3];
+}
+
+UT_TARGET_SSSE3 bool validate_ssse3(const char *data, size_t n)
+{
+    ssse3_state s{_mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128()};
+
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        validate_block(data + i, true, s);
+    }
+    if (i < n) {
+        // zero padding is ASCII, a sequence cut off by the end shows up as TOO_SHORT
+        simd::tail_block tail(data + i, n - i);
+        validate_block(tail.bytes, false, s);
+    }
+    const __m128i error = _mm_or_si128(s.error, s.incomplete);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+}
+
+#elif UT_SIMD_NEON
+
+inline uint8x16_t block_errors(uint8x16_t input, uint8x16_t prev, uint8x16_t t1h, uint8x16_t t1l, uint8x16_t t2h)
+{
+    const uint8x16_t prev1   = vextq_u8(prev, input, 15);
+    const uint8x16_t special = vandq_u8(vandq_u8(vqtbl1q_u8(t1h, vshrq_n_u8(prev1, 4)), vqtbl1q_u8(t1l, vandq_u8(prev1, vdupq_n_u8(0x0F)))),
+                                        vqtbl1q_u8(t2h, vshrq_n_u8(input, 4)));
+
+    const uint8x16_t prev2     = vextq_u8(prev, input, 14);
+    const uint8x16_t prev3     = vextq_u8(prev, input, 13);
+    const uint8x16_t is_third  = vqsubq_u8(prev2, vdupq_n_u8(0xE0 - 0x80));
+    const uint8x16_t is_fourth = vqsubq_u8(prev3, vdupq_n_u8(0xF0 - 0x80));
+    const uint8x16_t must23    = vandq_u8(vorrq_u8(is_third, is_fourth), vdupq_n_u8(0x80));
+    return veorq_u8(must23, special);
+}
+
+bool validate_neon(const char *data, size_t n)
+{
+    const uint8x16_t t1h = vld1q_u8(byte_1_high);
+    const uint8x16_t t1l = vld1q_u8(byte_1_low);
+    const uint8x16_t t2h = vld1q_u8(byte_2_high);
+    const uint8x16_t max = vld1q_u8(incomplete_max);
+
+    uint8x16_t error      = vdupq_n_u8(0);
+    uint8x16_t prev       = vdupq_n_u8(0);
+    uint8x16_t incomplete = vdupq_n_u8(0);
+
+    auto block = [&](const char *p, bool bCheckAscii) {
+        uint8x16_t v[4];
+        for (int i = 0; i < 4; ++i) {
+            v[i] = vld1q_u8(reinterpret_cast<const uint8_t *>(p + i * 16));
+        }
+        if (bCheckAscii && vmaxvq_u8(vorrq_u8(vorrq_u8(v[0], v[1]), vorrq_u8(v[2], v[3]))) < 0x80) {
+            error      = vorrq_u8(error, incomplete);
+            incomplete = vdupq_n_u8(0);
+        }
+        else {
+            error      = vorrq_u8(error, block_errors(v[0], prev, t1h, t1l, t2h));
+            error      = vorrq_u8(error, block_errors(v[1], v[0], t1h, t1l, t2h));
+            error      = vorrq_u8(error, block_errors(v[2], v[1], t1h, t1l, t2h));
+            error      = vorrq_u8(error, block_errors(v[3], v[2], t1h, t1l, t2h));
+            incomplete = vqsubq_u8(v[3], max);
+        }
+        prev = v[3];
+    };
+
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        block(data + i, true);
+    }
+    if (i < n) {
+        simd::tail_block tail(data + i, n - i);
+        block(tail.bytes, false);
+    }
+    return vmaxvq_u8(vorrq_u8(error, incomplete)) == 0;
+}
+
+#endif
+
+// whether the 16 bytes at p are ASCII
+inline bool ascii16(const char *p)
+{
+#if UT_SIMD_SSE2
+    return !_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+#else
+    uint64_t a, b;
+    std::memcpy(&a, p, 8);
+    std::memcpy(&b, p + 8, 8);
+    return !((a | b) & 0x8080808080808080);
+#endif
+}
+
+} // namespace
+
+
+bool validate(std::string_view utf8)
+{
+#if UT_UTF_X86
+    static const bool bSsse3 = has_ssse3();
+    if (bSsse3) {
+        return validate_ssse3(utf8.data(), utf8.size());
+    }
+#elif UT_SIMD_NEON
+    return validate_neon(utf8.data(), utf8.size());
+#endif
+    return scalar_valid_prefix(reinterpret_cast<const unsigned char *>(utf8.data()), utf8.size()) == utf8.size();
+}
+
+size_t valid_prefix(std::string_view utf8)
+{
+    if (validate(utf8)) {
+        return utf8.size();
+    }
+    return scalar_valid_prefix(reinterpret_cast<const unsigned char *>(utf8.data()), utf8.size());
+}
+
+size_t count_code_points(std::string_view utf8)
+{
+    const char *p     = utf8.data();
+    const char *end   = p + utf8.size();
+    size_t      count = 0;
+#if UT_SIMD_SSE2
+    // continuation bytes are 0x80..0xBF, as signed: < -64
+    const __m128i threshold = _mm_set1_epi8(-65);
+    for (; end - p >= 16; p += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        count += std::popcount(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(v, threshold))));
+    }
+#elif UT_SIMD_NEON
+    for (; end - p >= 16; p += 16) {
+        const int8x16_t v = vld1q_s8(reinterpret_cast<const int8_t *>(p));
+        count += vaddvq_u8(vandq_u8(vcgtq_s8(v, vdupq_n_s8(-65)), vdupq_n_u8(1)));
+    }
+#endif
+    for (; p < end; ++p) {
+        count += static_cast<signed char>(*p) > -65;
+    }
+    return count;
+}
+
+
+bool to_utf16(std::string_view utf8, std::u16string &out)
+{
+    if (!validate(utf8)) {
+        return false;
+    }
+    out.resize(utf8.size()); // never more units than bytes
+    const char *p   = utf8.data();
+    const char *end = p + utf8.size();
+    char16_t   *o   = out.data();
+
+    while (p < end) {
+        if (end - p >= 16 && ascii16(p)) {
+#if UT_SIMD_SSE2
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(o), _mm_unpacklo_epi8(v, _mm_setzero_si128()));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(o + 8), _mm_unpackhi_epi8(v, _mm_setzero_si128()));
+#else
+            for (int i = 0; i < 16; ++i) {
+                o[i] = static_cast<unsigned char>(p[i]);
+            }
+#endif
+            p += 16;
+            o += 16;
+            continue;
+        }
+        // decode up to the next 16 bytes one code point at a time, then try the ASCII path again
+        const char *stop = end - p > 16 ? p + 16 : end;
+        while (p < stop) {
+            char32_t cp;
+            p += decode_valid(reinterpret_cast<const unsigned char *>(p), cp);
+            if (cp < 0x10000) {
+                *o++ = static_cast<char16_t>(cp);
+            }
+            else {
+                cp -= 0x10000;
+                *o++ = static_cast<char16_t>(0xD800 | cp >> 10);
+                *o++ = static_cast<char16_t>(0xDC00 | (cp & 0x3FF));
+            }
+        }
+    }
+    out.resize(static_cast<size_t>(o - out.data()));
+    return true;
+}
+
+bool to_utf32(std::string_view utf8, std::u32string &out)
+{
+    if (!validate(utf8)) {
+        return false;
+    }
+    out.resize(utf8.size());
+    const char *p   = utf8.data();
+    const char *end = p + utf8.size();
+    char32_t   *o   = out.data();
+
+    while (p < end) {
+        if (end - p >= 16 && ascii16(p)) {
+#if UT_SIMD_SSE2
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i v    = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            const __m128i lo   = _mm_unpacklo_epi8(v, zero);
+            const __m128i hi   = _mm_unpackhi_epi8(v, zero);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(o), _mm_unpacklo_epi16(lo, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(o + 4), _mm_unpackhi_epi16(lo, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(o + 8), _mm_unpacklo_epi16(hi, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(o + 12), _mm_unpackhi_epi16(hi, zero));
+#else
+            for (int i = 0; i < 16; ++i) {
+                o[i] = static_cast<unsigned char>(p[i]);
+            }
+#endif
+            p += 16;
+            o += 16;
+            continue;
+        }
+        const char *stop = end - p > 16 ? p + 16 : end;
+        while (p < stop) {
+            p += decode_valid(reinterpret_cast<const unsigned char *>(p), *o++);
+        }
+    }
+    out.resize(static_cast<size_t>(o - out.data()));
+    return true;
+}
+
+bool from_utf16(std::u16string_view utf16, std::string &out)
+{
+    out.resize(utf16.size() * 3); // a surrogate pair (2 units) takes 4 bytes, anything else at most 3 per unit
+    const char16_t *p   = utf16.data();
+    const char16_t *end = p + utf16.size();
+    char           *o   = out.data();
+
+    while (p < end) {
+#if UT_SIMD_SSE2
+        if (end - p >= 8) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            const __m128i high = _mm_and_si128(v, _mm_set1_epi16(static_cast<short>(0xFF80)));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) == 0xFFFF) {
+                _mm_storel_epi64(reinterpret_cast<__m128i *>(o), _mm_packus_epi16(v, v));
+                p += 8;
+                o += 8;
+                continue;
+            }
+        }
+#endif
+        char32_t cp = *p++;
+        if (cp >= 0xD800 && cp <= 0xDFFF) {
+            if (cp > 0xDBFF || p == end || *p < 0xDC00 || *p > 0xDFFF) {
+                return false; // lone surrogate
+            }
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (*p++ - 0xDC00);
+        }
+        o = encode(cp, o);
+    }
+    out.resize(static_cast<size_t>(o - out.data()));
+    return true;
+}
+
+bool from_utf32(std::u32string_view utf32, std::string &out)
+{
+    out.resize(utf32.size() * 4);
+    char *o = out.data();
+    for (char32_t cp : utf32) {
+        if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+            return false;
+        }
+        o = encode(cp, o);
+    }
+    out.resize(static_cast<size_t>(o - out.data()));
+    return true;
+}
+
+} // namespace utf
+} // namespace ut
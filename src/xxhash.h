@@ -0,0 +1,101 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// internal helpers shared by the digests in src/, not part of the public headers
+
+namespace ut::xxhash
+{
+
+// XXH64 constants and steps
+inline constexpr uint64_t prime1 = 0x9E3779B185EBCA87ull;
+inline constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+inline constexpr uint64_t prime3 = 0x165667B19E3779F9ull;
+inline constexpr uint64_t prime4 = 0x85EBCA77C2B2AE63ull;
+inline constexpr uint64_t prime5 = 0x27D4EB2F165667C5ull;
+
+template <typename T>
+inline T load_le(const char *p)
+{
+    T v;
+    if constexpr (std::endian::native == std::endian::little) {
+        std::memcpy(&v, p, sizeof(T));
+    }
+    else {
+        v = 0;
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            v |= static_cast<T>(static_cast<unsigned char>(p[i])) << (8 * i);
+        }
+    }
+    return v;
+}
+
+inline uint64_t lane_round(uint64_t acc, uint64_t input)
+{
+    acc += input * prime2;
+    return std::rotl(acc, 31) * prime1;
+}
+
+inline uint64_t merge(uint64_t acc, uint64_t lane)
+{
+    acc ^= lane_round(0, lane);
+    return acc * prime1 + prime4;
+}
+
+/**
+ * XXH64 with seed 0, bytes read as little endian: unlike std::hash the value is defined,
+ * so whatever is persisted under it (tree_hash roots, blob_store names) is the same for every build and platform
+ */
+inline uint64_t hash64(std::string_view bytes)
+{
+    const char *p   = bytes.data();
+    const char *end = p + bytes.size();
+    uint64_t    h;
+
+    if (bytes.size() >= 32) {
+        // 4 independent lanes, 32 bytes per iteration
+        uint64_t v1 = prime1 + prime2, v2 = prime2, v3 = 0, v4 = 0 - prime1;
+        for (; end - p >= 32; p += 32) {
+            v1 = lane_round(v1, load_le<uint64_t>(p));
+            v2 = lane_round(v2, load_le<uint64_t>(p + 8));
+            v3 = lane_round(v3, load_le<uint64_t>(p + 16));
+            v4 = lane_round(v4, load_le<uint64_t>(p + 24));
+        }
+        h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+        h = merge(h, v1);
+        h = merge(h, v2);
+        h = merge(h, v3);
+        h = merge(h, v4);
+    }
+    else {
+        h = prime5;
+    }
+    h += bytes.size();
+
+    for (; end - p >= 8; p += 8) {
+        h ^= lane_round(0, load_le<uint64_t>(p));
+        h = std::rotl(h, 27) * prime1 + prime4;
+    }
+    if (end - p >= 4) {
+        h ^= load_le<uint32_t>(p) * prime1;
+        h = std::rotl(h, 23) * prime2 + prime3;
+        p += 4;
+    }
+    for (; p != end; ++p) {
+        h ^= static_cast<unsigned char>(*p) * prime5;
+        h = std::rotl(h, 11) * prime1;
+    }
+
+    h ^= h >> 33;
+    h *= prime2;
+    h ^= h >> 29;
+    h *= prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+} // namespace ut::xxhash
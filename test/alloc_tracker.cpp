@@ -0,0 +1,138 @@
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utility.cc/alloc_tracker.h"
+#include "utility.cc/string_utils.h"
+
+// the library installs the hooks itself when built with utility_alloc_tracking
+#if !UTILITY_ALLOC_TRACKING
+UT_ALLOC_DEFINE_HOOKS()
+#endif
+
+
+void testCounters()
+{
+    auto before = ut::alloc::thread_totals();
+    auto p      = std::make_unique<std::vector<int>>(1000);
+    auto mid    = ut::alloc::thread_totals();
+    assert(ut::alloc::hooked());
+    assert(mid.allocations - before.allocations == 2);
+    assert(mid.bytes - before.bytes >= 1000 * sizeof(int));
+    assert(mid.peak_bytes >= mid.live_bytes);
+
+    p.reset();
+    auto after = ut::alloc::thread_totals();
+    assert(after.frees - before.frees == 2);
+    assert(after.live_bytes == before.live_bytes);
+
+    // aligned and nothrow forms go through the same header
+    struct alignas(64) line
+    {
+        char bytes[64];
+    };
+    auto *l = new line;
+    assert(reinterpret_cast<uintptr_t>(l) % 64 == 0);
+    delete l;
+    auto *n = new (std::nothrow) int[4];
+    delete[] n;
+    assert(ut::alloc::thread_totals().live_bytes == before.live_bytes);
+
+    // other threads don't show up in this thread's totals
+    before = ut::alloc::thread_totals();
+    std::thread([]() { std::vector<char> v(4096); }).join();
+    assert(ut::alloc::thread_totals().allocations - before.allocations <= 1); // the thread's own state
+    assert(ut::alloc::totals().allocations > 0);
+}
+
+void testScopes()
+{
+    ut::alloc::reset();
+    for (int i = 0; i < 3; ++i) {
+        ut::alloc::scope outer("outer");
+        std::vector<char> big(10000);
+        {
+            ut::alloc::scope inner("inner");
+            std::string      s(100, 'x');
+            assert(inner.so_far().allocations == 1);
+        }
+        assert(outer.so_far().allocations == 2);
+        assert(outer.so_far().peak_bytes >= 10100);
+    }
+
+    auto sites = ut::alloc::report();
+    assert(sites.size() == 2);
+    assert(sites[0].tag == "outer" && sites[0].runs == 3);
+    assert(sites[0].total.allocations == 6 && sites[0].total.live_bytes == 0);
+    assert(sites[0].line > 0 && sites[0].file.find("alloc_tracker") != std::string::npos);
+    assert(sites[1].tag == "inner" && sites[1].total.peak_bytes >= 100 && sites[1].total.peak_bytes < 10000);
+
+    // tags built at runtime are gone before the report, it keeps its own copy
+    ut::alloc::reset();
+    for (int i = 0; i < 2; ++i) {
+        ut::alloc::scope s(std::string("decode/") + std::string(32, char('a' + i)));
+        std::vector<char> v(64);
+    }
+    sites = ut::alloc::report();
+    assert(sites.size() == 2);
+    assert(sites[0].tag != sites[1].tag);
+    for (const auto &x : sites) {
+        assert(x.tag == "decode/" + std::string(32, 'a') || x.tag == "decode/" + std::string(32, 'b'));
+    }
+    assert(sites[0].total.allocations == 1 && sites[1].total.allocations == 1);
+
+    // the tracker's own copies (a long tag, the report) are neither allocations nor frees of the code around them
+    ut::alloc::reset();
+    const std::string idle_tag(64, 'i');
+    auto              before = ut::alloc::thread_totals();
+    {
+        ut::alloc::scope outer("outer");
+        {
+            ut::alloc::scope idle(idle_tag);
+        }
+        assert(outer.so_far().allocations == 0 && outer.so_far().frees == 0);
+    }
+    sites = ut::alloc::report();
+    assert(sites.size() == 2 && sites[0].total.allocations == 0 && sites[0].total.frees == 0);
+    assert(sites[1].total.allocations == 0 && sites[1].total.frees == 0);
+    sites.clear();
+    sites.shrink_to_fit();
+    auto after = ut::alloc::thread_totals();
+    assert(after.allocations == before.allocations && after.frees == before.frees && after.live_bytes == before.live_bytes);
+
+    ut::alloc::reset();
+    assert(ut::alloc::report().empty());
+}
+
+void testExpectNoAlloc()
+{
+    std::string line = "key=value";
+
+    UT_EXPECT_NO_ALLOC
+    {
+        auto parts = ut::str::split_view<2>(line, '=');
+        assert(parts.size() == 2 && parts[1] == "value");
+    }
+
+    auto before = ut::alloc::thread_totals().allocations;
+    UT_EXPECT_ALLOCS(3)
+    {
+        auto parts = ut::str::split(line, '=');
+        assert(parts.size() == 2);
+    }
+    assert(ut::alloc::thread_totals().allocations > before);
+}
+
+int main()
+{
+    testCounters();
+    testScopes();
+    testExpectNoAlloc();
+
+    std::cout << "alloc_tracker ok" << std::endl;
+    return 0;
+}
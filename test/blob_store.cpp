@@ -0,0 +1,105 @@
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "utility.cc/blob_store.h"
+#include "utility.cc/file_utils.h"
+
+
+void testDigest()
+{
+    ut::blob_digest d{.hash = 0x00ab'cdef'0123'4567, .size = 42};
+    assert(d.str() == "00abcdef01234567-42");
+    assert(ut::blob_digest::parse(d.str()) == d);
+
+    d.variant = 3;
+    assert(ut::blob_digest::parse(d.str()) == d);
+
+    assert(!ut::blob_digest::parse("xyz") && !ut::blob_digest::parse("00abcdef01234567-") &&
+           !ut::blob_digest::parse("00abcdef01234567-42-0") && !ut::blob_digest::parse("00abcdef01234567-42x"));
+
+    // names are persisted: XXH64, pinned to the reference value
+    assert(ut::blob_digest::of("abc").str() == "44bc2cf5ad770999-3");
+}
+
+void testStore()
+{
+    auto root = std::filesystem::temp_directory_path() / "ut_test_blob_store";
+    std::filesystem::remove_all(root);
+
+    std::string bytes = "same bytes for every build variant";
+    {
+        ut::blob_store store(root);
+        assert(store.is_valid() && store.size() == 0);
+
+        auto a = store.put(bytes);
+        auto b = store.put(bytes);
+        assert(a && b && *a == *b && store.size() == 1 && store.contains(*a));
+        assert(*a == ut::blob_digest::of(bytes) && a->size == bytes.size());
+
+        auto mapped = store.open(*a);
+        assert(mapped && mapped->view() == bytes);
+
+        // ingest a file, both ways, and get the same digest
+        auto src = root.parent_path() / "ut_test_blob_src.bin";
+        std::ofstream(src, std::ios::binary) << "artifact";
+        auto f1 = store.put_file(src);
+        auto f2 = store.put_file(src, true);
+        assert(f1 && f2 && *f1 == *f2 && store.size() == 2);
+        assert(*f1 == ut::blob_digest::of("artifact"));
+
+        auto out = root.parent_path() / "ut_test_blob_out.bin";
+        assert(store.export_to(*f1, out, false));
+        assert(*ut::file::read_all(out) == "artifact");
+        std::filesystem::remove(out);
+
+        // by default the export is a copy: writing to it leaves the stored object alone
+        assert(store.export_to(*f1, out));
+        const auto perms = std::filesystem::status(out).permissions();
+        assert((perms & std::filesystem::perms::owner_write) != std::filesystem::perms::none);
+        std::ofstream(out, std::ios::binary | std::ios::trunc) << "modified";
+        assert(store.open(*f1)->view() == "artifact");
+        std::filesystem::remove(out);
+        std::filesystem::remove(src);
+
+        assert(store.remove(*f1) && !store.contains(*f1) && store.size() == 1);
+        assert(!store.export_to(*f1, out));
+    }
+
+    // the index is rebuilt from disk
+    ut::blob_store reopened(root);
+    assert(reopened.size() == 1);
+    assert(reopened.contains(*reopened.put(bytes)));
+
+    // many blobs: the open addressing index grows and erases correctly
+    for (int i = 0; i < 300; ++i) {
+        assert(reopened.put("blob " + std::to_string(i)));
+    }
+    assert(reopened.size() == 301);
+    for (int i = 0; i < 300; i += 2) {
+        std::string s = "blob " + std::to_string(i);
+        assert(reopened.remove(ut::blob_digest::of(s)));
+    }
+    for (int i = 0; i < 300; ++i) {
+        std::string s = "blob " + std::to_string(i);
+        assert(reopened.contains(ut::blob_digest::of(s)) == (i % 2 == 1));
+    }
+
+    // a store from a build that named objects with std::hash has no format file, one from elsewhere another format
+    std::filesystem::remove(root / "format");
+    assert(!ut::blob_store(root).is_valid());
+    std::ofstream(root / "format", std::ios::binary) << "ut-blob-store 9 sha256\n";
+    assert(!ut::blob_store(root).is_valid());
+
+    std::filesystem::remove_all(root);
+}
+
+int main()
+{
+    testDigest();
+    testStore();
+    std::cout << "blob_store ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,148 @@
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "utility.cc/constexpr_utils.h"
+#include "utility.cc/file_utils.h"
+
+
+template <int N>
+int square() { return N * N; }
+
+void testStaticFor()
+{
+    // args are seen by every iteration, the string is not moved out after the first one
+    std::string tag = "x";
+    int         sum = 0;
+    static_for<0, 4>([&sum](auto i, const std::string &s) { sum += i() + static_cast<int>(s.size()); }, tag);
+    assert(sum == 0 + 1 + 2 + 3 + 4);
+    assert(tag == "x");
+}
+
+void testDispatch()
+{
+    for (int i = 0; i <= 8; ++i) {
+        int v = ut::dispatch<0, 8>(i, [](auto n) { return square<n()>(); });
+        assert(v == i * i);
+    }
+
+    static_assert(ut::dispatch<2, 5>(3, [](auto n) { return n() * 10; }) == 30);
+
+    bool bThrown = false;
+    try {
+        ut::dispatch<0, 8>(9, [](auto n) { return n(); });
+    }
+    catch (const std::out_of_range &) {
+        bThrown = true;
+    }
+    assert(bThrown);
+
+    assert((ut::dispatch<0, 8>(42, [](auto n) { return n(); }, [](int v) { return -v; }) == -42));
+
+    using Format = ut::file::ImageInfo::Format;
+    auto name    = [](auto fmt) -> std::string {
+        if constexpr (fmt() == Format::PNG) {
+            return "png";
+        }
+        else if constexpr (fmt() == Format::TIFF) {
+            return "tiff";
+        }
+        else {
+            return "other";
+        }
+    };
+    assert((ut::dispatch<Format::UNKNOWN, Format::TIFF>(Format::PNG, name) == "png"));
+    assert((ut::dispatch<Format::UNKNOWN, Format::TIFF>(Format::GIF, name) == "other"));
+}
+
+void testDispatchMulti()
+{
+    auto fn = [](auto a, auto b, auto c) { return a() * 100 + b() * 10 + (c() ? 1 : 0); };
+    for (int a = 1; a <= 3; ++a) {
+        for (int b = 0; b <= 4; ++b) {
+            for (bool c : {false, true}) {
+                int v = ut::dispatch(fn, ut::dispatch_axis<1, 3>{a}, ut::dispatch_axis<0, 4>{b}, ut::dispatch_axis<false, true>{c});
+                assert(v == a * 100 + b * 10 + (c ? 1 : 0));
+            }
+        }
+    }
+}
+
+using namespace ut::literals;
+
+static_assert("hello"_h == 0xA430D84680AABD0Bull); // FNV-1a test vector
+static_assert(ut::fnv1a("") == 0xCBF29CE484222325ull);
+
+int command(std::string_view name)
+{
+    switch (ut::fnv1a(name)) {
+    case "run"_h:
+        return 1;
+    case "stop"_h:
+        return 2;
+    default:
+        return 0;
+    }
+}
+
+void testStringHash()
+{
+    // identical at runtime, here from a string built at runtime
+    std::string key = "hel";
+    key += "lo";
+    assert(ut::fnv1a(key) == "hello"_h);
+    assert(command(std::string("stop")) == 2 && command("run") == 1 && command("status") == 0);
+
+    constexpr auto keywords = ut::make_perfect_hash({"if", "else", "while", "for", "return", "break", "continue", "switch", "case"});
+    static_assert(keywords.size() == 9);
+    static_assert(keywords.find("while") == 2 && keywords.key(2) == "while");
+    static_assert(!keywords.contains("whilst") && !keywords.contains(""));
+
+    auto kind = [&](std::string_view word) {
+        switch (keywords.find(word)) {
+        case keywords.find("if"):
+        case keywords.find("else"):
+            return 1;
+        case keywords.find("return"):
+            return 2;
+        case keywords.npos:
+            return -1;
+        default:
+            return 0;
+        }
+    };
+    assert(kind(std::string("else")) == 1 && kind("return") == 2 && kind("for") == 0 && kind("elsewhere") == -1);
+
+    // a bigger set, every key back at its own index
+    static constexpr std::string_view many[] = {
+        "alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel", "india", "juliett", "kilo", "lima", "mike",
+        "november", "oscar", "papa", "quebec", "romeo", "sierra", "tango", "uniform", "victor", "whiskey", "xray", "yankee", "zulu",
+        "zero", "one", "two", "three", "four", "five", "six", "seven", "eight", "nine", "ten"};
+    constexpr auto table = ut::make_perfect_hash(many);
+    for (size_t i = 0; i < std::size(many); ++i) {
+        assert(table.find(std::string(many[i])) == i);
+        assert(!table.contains(std::string(many[i]) + "!"));
+    }
+
+    // duplicates are rejected, a compile error when constexpr
+    bool bThrown = false;
+    try {
+        ut::make_perfect_hash({"a", "b", "a"});
+    }
+    catch (const std::invalid_argument &) {
+        bThrown = true;
+    }
+    assert(bThrown);
+}
+
+int main()
+{
+    testStaticFor();
+    testDispatch();
+    testDispatchMulti();
+    testStringHash();
+    std::cout << "constexpr_utils ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,176 @@
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "utility.cc/csv.h"
+
+using table = std::vector<std::vector<std::string>>;
+
+table collect(ut::csv::reader &r)
+{
+    table         ret;
+    ut::csv::row  fields;
+    while (r.next(fields)) {
+        ret.emplace_back(fields.begin(), fields.end());
+    }
+    return ret;
+}
+
+// plain state machine, the reference for the block based tokenizer
+table reference(const std::string &text)
+{
+    table                    ret;
+    std::vector<std::string> rec;
+    std::string              cur;
+    bool                     bQuoted = false, bAny = false;
+    for (size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        bAny   = true;
+        if (bQuoted) {
+            if (c == '"' && i + 1 < text.size() && text[i + 1] == '"') {
+                cur += '"';
+                ++i;
+            }
+            else if (c == '"') {
+                bQuoted = false;
+            }
+            else {
+                cur += c;
+            }
+        }
+        else if (c == '"') {
+            bQuoted = true;
+        }
+        else if (c == ',') {
+            rec.push_back(cur);
+            cur.clear();
+        }
+        else if (c == '\n') {
+            rec.push_back(cur);
+            ret.push_back(rec);
+            rec.clear();
+            cur.clear();
+            bAny = false;
+        }
+        else {
+            cur += c;
+        }
+    }
+    if (bAny) {
+        rec.push_back(cur);
+        ret.push_back(rec);
+    }
+    return ret;
+}
+
+std::string random_csv(size_t records, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::string  out;
+    for (size_t r = 0; r < records; ++r) {
+        int fields = 1 + rng() % 6;
+        for (int f = 0; f < fields; ++f) {
+            if (f) {
+                out += ',';
+            }
+            switch (rng() % 4) {
+            case 0:
+                break;
+            case 1:
+                out += "plain" + std::to_string(rng() % 1000);
+                break;
+            case 2:
+                out += "\"with, comma\nand newline\"";
+                break;
+            default:
+                out += "\"say \"\"hi\"\"\"";
+            }
+        }
+        out += '\n';
+    }
+    return out;
+}
+
+void testBasics()
+{
+    ut::csv::reader r("a,b,c\r\n\"x,y\",\"he said \"\"no\"\"\",\n1,,3");
+    table           t = collect(r);
+    assert(t.size() == 3);
+    assert((t[0] == std::vector<std::string>{"a", "b", "c"}));
+    assert((t[1] == std::vector<std::string>{"x,y", "he said \"no\"", ""}));
+    assert((t[2] == std::vector<std::string>{"1", "", "3"}));
+    assert(r.records() == 3);
+
+    ut::csv::reader tsv("k\tv\n", {.delimiter = '\t'});
+    assert((collect(tsv) == table{{"k", "v"}}));
+
+    // unescaped fields are views into the input
+    std::string  text = "abc,\"q\"\n";
+    ut::csv::reader z(text);
+    ut::csv::row    fields;
+    assert(z.next(fields) && fields[0].data() == text.data() && fields[1].data() == text.data() + 5);
+}
+
+void testMatchesReference()
+{
+    std::string text = random_csv(2000, 7);
+    table       want = reference(text);
+
+    ut::csv::reader buf(text, {.chunk_size = 64});
+    assert(collect(buf) == want);
+
+    // a small chunk size makes records straddle refills
+    auto path = std::filesystem::temp_directory_path() / "ut_test_csv.csv";
+    std::ofstream(path, std::ios::binary) << text;
+    for (size_t chunk : {1, 13, 64, 4096}) {
+        auto r = ut::csv::reader::open(path, {.chunk_size = chunk});
+        assert(r);
+        assert(collect(*r) == want);
+    }
+
+    // input ending exactly on a chunk boundary, with and without the last newline
+    for (const std::string &exact : {std::string("a,b\nc,d"), std::string("ab,cd\nef"), std::string("a,b\nc,d\n"), std::string("ab,cd\nef\n")}) {
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << exact;
+        for (size_t chunk : {exact.size(), exact.size() / 2, size_t(1)}) {
+            if (exact.size() % chunk) {
+                continue;
+            }
+            auto r = ut::csv::reader::open(path, {.chunk_size = chunk});
+            assert(r && collect(*r) == reference(exact));
+        }
+    }
+    std::filesystem::remove(path);
+
+    assert(!ut::csv::reader::open("/nonexistent/ut_test.csv"));
+}
+
+void testSplitRecords()
+{
+    std::string text = random_csv(5000, 11);
+    table       want = reference(text);
+
+    for (size_t parts : {2, 3, 8, 64}) {
+        auto  slices = ut::csv::split_records(text, parts);
+        table got;
+        for (auto s : slices) {
+            ut::csv::reader r(s);
+            for (auto &rec : collect(r)) {
+                got.push_back(std::move(rec));
+            }
+        }
+        assert(got == want);
+    }
+}
+
+int main()
+{
+    testBasics();
+    testMatchesReference();
+    testSplitRecords();
+    std::cout << "csv ok" << std::endl;
+    return 0;
+}
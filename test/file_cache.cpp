@@ -0,0 +1,112 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "utility.cc/file_cache.h"
+#include "utility.cc/file_utils.h"
+
+
+static std::filesystem::path write_file(const std::filesystem::path &path, const std::string &content)
+{
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << content;
+    return path;
+}
+
+template <typename Pred>
+static bool wait_for(Pred pred)
+{
+    for (int i = 0; i < 300 && !pred(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return pred();
+}
+
+void testHitsAndEviction()
+{
+    auto dir = std::filesystem::temp_directory_path() / "ut_test_file_cache";
+    std::filesystem::create_directories(dir);
+    auto a = write_file(dir / "a.txt", std::string(100, 'a'));
+    auto b = write_file(dir / "b.txt", std::string(100, 'b'));
+    auto c = write_file(dir / "c.txt", std::string(100, 'c'));
+
+    ut::file::content_cache cache({.byte_budget = 250, .bWatch = false});
+
+    auto first  = cache.get(a);
+    auto second = cache.get(a);
+    assert(first && first == second && *first == std::string(100, 'a'));
+    assert(cache.statistics().hits == 1 && cache.statistics().misses == 1);
+
+    cache.get(b);
+    cache.get(a); // a is now more recent than b
+    cache.get(c); // over budget: b goes
+    auto s = cache.statistics();
+    assert(s.evictions >= 1 && s.bytes <= 250);
+    cache.get(a);
+    assert(cache.statistics().hits == s.hits + 1);
+
+    // buffers outlive invalidation
+    cache.invalidate(a);
+    assert(*first == std::string(100, 'a'));
+
+    assert(!cache.get(dir / "missing.txt"));
+
+    // concurrent readers of one file share the buffer
+    cache.clear();
+    std::atomic<int> same = 0;
+    auto             ref  = cache.get(c);
+    std::thread      readers[4];
+    for (auto &t : readers) {
+        t = std::thread([&]() {
+            for (int i = 0; i < 1000; ++i) {
+                same += cache.get(c) == ref;
+            }
+        });
+    }
+    for (auto &t : readers) {
+        t.join();
+    }
+    assert(same == 4000);
+
+    std::filesystem::remove_all(dir);
+}
+
+void testWatch()
+{
+    auto dir = std::filesystem::temp_directory_path() / "ut_test_file_cache_watch";
+    std::filesystem::create_directories(dir);
+    auto path = write_file(dir / "shader.glsl", "v1");
+
+    ut::file::content_cache cache({.poll_interval = std::chrono::milliseconds(20)});
+    std::atomic<int>        notified = 0;
+    auto                    id       = cache.subscribe(path, [&](const std::filesystem::path &) { ++notified; });
+
+    assert(*cache.get(path) == "v1");
+
+    // give mtime polling a different timestamp to see
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    write_file(path, "v2, longer");
+    assert(wait_for([&]() { return notified > 0; }));
+    assert(wait_for([&]() { return *cache.get(path) == "v2, longer"; }));
+
+    cache.unsubscribe(id);
+    std::filesystem::remove_all(dir);
+}
+
+int main()
+{
+    testHitsAndEviction();
+    testWatch();
+
+    auto path = std::filesystem::temp_directory_path() / "ut_test_read_cached.txt";
+    write_file(path, "shared");
+    assert(ut::FileUtils::read_cached(path) == ut::FileUtils::read_cached(path));
+    std::filesystem::remove(path);
+
+    std::cout << "file_cache ok" << std::endl;
+    return 0;
+}
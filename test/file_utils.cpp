@@ -0,0 +1,143 @@
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "utility.cc/file_utils.h"
+
+
+static std::filesystem::path temp_path(const std::string &name)
+{
+    return std::filesystem::temp_directory_path() / name;
+}
+
+void testMappedFile()
+{
+    auto path = temp_path("ut_test_mapped.txt");
+    std::ofstream(path, std::ios::binary) << "hello";
+
+    auto f = ut::file::mapped_file::open(path);
+    assert(f && f->view() == "hello");
+
+    std::ofstream(path, std::ios::binary | std::ios::app) << " world";
+    assert(f->remap() && f->view() == "hello world");
+
+    std::ofstream(path, std::ios::binary | std::ios::trunc);
+    assert(f->remap() && f->size() == 0);
+
+    assert(!ut::file::mapped_file::open(temp_path("ut_test_missing/none.txt")));
+    std::filesystem::remove(path);
+}
+
+void testLineIndex()
+{
+    // lines of varying length, some longer than a varint byte and some CRLF
+    std::vector<std::string> lines;
+    std::string              text;
+    for (int i = 0; i < 5000; ++i) {
+        lines.push_back(std::string(i % 300, char('a' + i % 26)) + (i % 7 == 0 ? "\r" : ""));
+        text += lines.back() + "\n";
+    }
+
+    for (uint32_t every : {1u, 3u, 64u}) {
+        ut::file::line_index index(every);
+        index.update(text);
+        assert(index.lines() == lines.size());
+        for (size_t i = 0; i < lines.size(); i += 37) {
+            std::string_view want = lines[i];
+            if (!want.empty() && want.back() == '\r') {
+                want.remove_suffix(1);
+            }
+            assert(index.line(text, i) == want);
+        }
+        assert(!index.offset(lines.size()));
+    }
+
+    // tailing: an unterminated line, then appends
+    auto path = temp_path("ut_test_lines.log");
+    std::ofstream(path, std::ios::binary) << "first\nsecond";
+    auto index = ut::file::line_index::build(path, 2);
+    assert(index && index->lines() == 2);
+
+    std::ofstream(path, std::ios::binary | std::ios::app) << " half\nthird\n";
+    auto f = ut::file::mapped_file::open(path);
+    index->update(f->view());
+    assert(index->indexed_bytes() == f->size() && index->lines() == 3);
+    assert(index->line(f->view(), 1) == "second half" && index->line(f->view(), 2) == "third");
+
+    // persisted and reloaded, then extended
+    auto saved = temp_path("ut_test_lines.idx");
+    assert(index->save(saved));
+    auto loaded = ut::file::line_index::load(saved);
+    assert(loaded && loaded->lines() == 3 && loaded->offset(2) == index->offset(2));
+
+    std::ofstream(path, std::ios::binary | std::ios::app) << "fourth\n";
+    assert(loaded->update_file(path) && loaded->lines() == 4);
+    f->remap();
+    assert(loaded->line(f->view(), 3) == "fourth");
+
+    // a shorter file was replaced, start over
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << "x\n";
+    assert(loaded->update_file(path) && loaded->lines() == 1);
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(saved);
+}
+
+// a saved index with damaged fields is refused instead of trusted
+void testLineIndexCorrupt()
+{
+    std::string text;
+    for (int i = 0; i < 100; ++i) {
+        text += std::string(static_cast<size_t>(i * 3), 'x') + "\n";
+    }
+    ut::file::line_index index(4);
+    index.update(text);
+    auto saved = temp_path("ut_test_corrupt.idx");
+    assert(index.save(saved));
+
+    std::string good;
+    {
+        std::ifstream in(saved, std::ios::binary);
+        good.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    // magic, every, newlines, last start, scanned, sample count, delta count, then the samples {offset, delta_pos}
+    constexpr size_t samples_at = 8 + 4 + 5 * 8;
+    auto             load_with  = [&](size_t at, uint64_t value) {
+        std::string bytes = good;
+        std::memcpy(bytes.data() + at, &value, sizeof(value));
+        std::ofstream(saved, std::ios::binary | std::ios::trunc) << bytes;
+        return ut::file::line_index::load(saved);
+    };
+
+    assert(load_with(samples_at + 16, 1 + 4 + 7 + 10)); // sample 1 as saved
+    assert(!load_with(samples_at + 16, 0));             // line starts going backwards
+    assert(!load_with(samples_at + 24, 1ull << 40));    // varints past the end of the table
+    assert(!load_with(samples_at + 24, 0));             // sample 1's lengths overlapping sample 0's
+    assert(!load_with(8 + 4 + 8, 1ull << 40));          // last start beyond the scanned bytes
+
+    // a varint that never ends
+    std::string bytes = good;
+    bytes.back()      = static_cast<char>(0x80);
+    std::ofstream(saved, std::ios::binary | std::ios::trunc) << bytes;
+    assert(!ut::file::line_index::load(saved));
+
+    // counts bigger than the file
+    assert(!load_with(8 + 4 + 4 * 8, 1ull << 50));
+
+    std::filesystem::remove(saved);
+}
+
+int main()
+{
+    testMappedFile();
+    testLineIndex();
+    testLineIndexCorrupt();
+    std::cout << "file_utils ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,158 @@
+#include <atomic>
+#include <cassert>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "utility.cc/job_system.h"
+
+
+void testDependencies(ut::job_system &jobs)
+{
+    std::mutex       mutex;
+    std::vector<int> order;
+    auto             record = [&](int v) {
+        std::lock_guard lock(mutex);
+        order.push_back(v);
+    };
+
+    // a -> {b, c} -> d
+    auto a = jobs.submit([&]() { record(1); });
+    auto b = jobs.then(a, [&]() { record(2); });
+    auto c = jobs.then(a, [&]() { record(2); });
+    auto d = jobs.submit([&]() { record(3); }, {b, c});
+    jobs.wait(d);
+
+    assert(a.done() && b.done() && c.done() && d.done());
+    assert(order.size() == 4);
+    assert(order[0] == 1 && order[1] == 2 && order[2] == 2 && order[3] == 3);
+
+    // depending on an already finished job schedules right away
+    auto e = jobs.then(d, [&]() { record(4); });
+    jobs.wait(e);
+    assert(order.back() == 4);
+
+    std::cout << "dependencies ok" << std::endl;
+}
+
+// recursive fork/join, every level waits inside a job
+int fib(ut::job_system &jobs, int n)
+{
+    if (n < 12) {
+        return n < 2 ? n : fib(jobs, n - 1) + fib(jobs, n - 2);
+    }
+    int  left  = 0;
+    auto child = jobs.submit([&]() { left = fib(jobs, n - 1); });
+    int  right = fib(jobs, n - 2);
+    jobs.wait(child);
+    return left + right;
+}
+
+void testNestedWait(ut::job_system &jobs)
+{
+    int result = 0;
+    jobs.wait(jobs.submit([&]() { result = fib(jobs, 24); }));
+    assert(result == 46368);
+    std::cout << "nested wait ok" << std::endl;
+}
+
+void testExceptions(ut::job_system &jobs)
+{
+    auto failing = jobs.submit([]() { throw std::runtime_error("boom"); });
+    bool bThrown = false;
+    try {
+        jobs.wait(failing);
+    }
+    catch (const std::runtime_error &) {
+        bThrown = true;
+    }
+    assert(bThrown);
+
+    // continuations still run after a failed dependency
+    std::atomic<bool> bRan{false};
+    jobs.wait(jobs.then(failing, [&]() { bRan = true; }));
+    assert(bRan);
+
+    std::cout << "exceptions ok" << std::endl;
+}
+
+void testParallel(ut::job_system &jobs)
+{
+    std::vector<std::atomic<int>> hits(10000);
+    jobs.parallel(hits.size(), [&](size_t i) { hits[i]++; });
+    for (auto &h : hits) {
+        assert(h == 1);
+    }
+    std::cout << "parallel ok" << std::endl;
+}
+
+void testShutdown()
+{
+    std::atomic<int> count{0};
+    {
+        ut::job_system jobs(3);
+        for (int i = 0; i < 1000; ++i) {
+            // fire and forget, each one also spawns a continuation
+            auto h = jobs.submit([&]() { ++count; });
+            jobs.then(h, [&]() { ++count; });
+        }
+        jobs.shutdown(); // drains everything, then joins
+
+        assert(count == 2000);
+        assert(jobs.statistics().executed == 2000); // whether a worker or the draining thread ran them
+
+        bool bThrown = false;
+        try {
+            jobs.submit([]() {});
+        }
+        catch (const std::runtime_error &) {
+            bThrown = true;
+        }
+        assert(bThrown);
+    } // second shutdown() from the destructor is a no-op
+
+    std::cout << "shutdown ok" << std::endl;
+}
+
+void testHelpingAndThreadExit()
+{
+    // no workers: every job runs on the waiting thread, and is counted
+    ut::job_system alone(0);
+    for (int i = 0; i < 10; ++i) {
+        alone.wait(alone.submit([]() {}));
+    }
+    assert(alone.statistics().executed == 10 && alone.worker_statistics().empty());
+
+    // a handle dropped after the thread's job cache is gone (destroyed first, it was created last)
+    struct holder
+    {
+        ut::job_handle h;
+    };
+    ut::job_system jobs(1);
+    std::thread([&]() {
+        static thread_local holder hold;
+        hold.h = jobs.submit([]() {});
+        jobs.wait(hold.h);
+    }).join();
+
+    std::cout << "helping ok" << std::endl;
+}
+
+int main()
+{
+    ut::job_system jobs(4);
+
+    testDependencies(jobs);
+    testNestedWait(jobs);
+    testExceptions(jobs);
+    testParallel(jobs);
+    testShutdown();
+    testHelpingAndThreadExit();
+
+    auto s = jobs.statistics();
+    std::cout << "executed: " << s.executed << " steals: " << s.steals << " failed steals: " << s.failed_steals
+              << " idle ms: " << s.idle_ns / 1e6 << std::endl;
+    return 0;
+}
@@ -0,0 +1,173 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "utility.cc/hash.h"
+#include "utility.cc/lru_cache.h"
+
+
+void testLru()
+{
+    ut::lru_cache<int, std::string> cache({.capacity = 3, .shards = 1});
+    cache.put(1, "one");
+    cache.put(2, "two");
+    cache.put(3, "three");
+    assert(cache.get(1) == "one"); // 2 is now the least recent
+
+    cache.put(4, "four");
+    assert(!cache.contains(2) && cache.contains(1) && cache.contains(3) && cache.contains(4));
+    assert(!cache.get(2));
+
+    cache.put(3, "THREE"); // replace, moves to the front
+    assert(cache.get(3) == "THREE");
+    assert(cache.erase(1) && !cache.erase(1));
+
+    auto s = cache.statistics();
+    assert(s.hits == 2 && s.misses == 1 && s.evictions == 1 && s.entries == 2 && s.cost == 2);
+
+    cache.clear();
+    assert(cache.statistics().entries == 0 && !cache.get(3));
+}
+
+void testCost()
+{
+    // priced in bytes: the budget holds whatever number of entries fits
+    ut::lru_cache<int, std::string> cache({
+        .capacity = 100,
+        .shards   = 1,
+        .cost     = [](const int &, const std::string &v) { return v.size(); },
+    });
+    for (int i = 0; i < 10; ++i) {
+        cache.put(i, std::string(30, 'x'));
+    }
+    auto s = cache.statistics();
+    assert(s.entries == 3 && s.cost == 90 && s.evictions == 7);
+    assert(cache.contains(9) && cache.contains(7) && !cache.contains(6));
+
+    // bigger than the whole budget: not kept, and it doesn't flush the rest either
+    cache.put(100, std::string(150, 'y'));
+    assert(!cache.contains(100) && cache.contains(7) && cache.statistics().cost == 90);
+    cache.put(9, std::string(150, 'y')); // nor is the old value kept
+    assert(!cache.contains(9) && cache.statistics().cost == 60);
+}
+
+void testClock()
+{
+    ut::lru_cache<int, int> cache({.capacity = 3, .shards = 1, .policy = ut::cache_eviction::clock});
+    cache.put(1, 10);
+    cache.put(2, 20);
+    cache.put(3, 30);
+    assert(cache.get(1) == 10);
+
+    // the sweep spares 1 once (it was used) and takes 2
+    cache.put(4, 40);
+    assert(cache.contains(1) && !cache.contains(2) && cache.contains(3) && cache.contains(4));
+    cache.put(5, 50);
+    assert(cache.statistics().entries == 3 && cache.statistics().evictions == 2);
+}
+
+void testCoalescing()
+{
+    ut::lru_cache<std::string, int> cache;
+    std::atomic<int>                computed{0};
+    std::vector<std::thread>        threads;
+    std::vector<int>                results(8);
+
+    for (int i = 0; i < 8; ++i) {
+        threads.emplace_back([&, i]() {
+            results[i] = cache.get_or_compute("config", [&]() {
+                ++computed;
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                return 42;
+            });
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    assert(computed == 1);
+    for (int v : results) {
+        assert(v == 42);
+    }
+    auto s = cache.statistics();
+    assert(s.misses == 1 && s.hits + s.coalesced == 7);
+
+    // an exception reaches the caller and nothing is cached, the next call computes again
+    bool bThrown = false;
+    try {
+        cache.get_or_compute("broken", []() -> int { throw std::runtime_error("parse error"); });
+    }
+    catch (const std::runtime_error &) {
+        bThrown = true;
+    }
+    assert(bThrown && !cache.contains("broken"));
+    assert(cache.get_or_compute("broken", []() { return 7; }) == 7);
+}
+
+// what the image metadata memo uses: a path plus its size, hashed with hashCombined
+struct file_key
+{
+    std::string path;
+    size_t      size = 0;
+
+    bool operator==(const file_key &) const = default;
+};
+
+struct file_key_hash
+{
+    size_t operator()(const file_key &k) const
+    {
+        size_t seed = 0;
+        ut::hashCombined(seed, k.path);
+        ut::hashCombined(seed, k.size);
+        return seed;
+    }
+};
+
+void testConcurrent(ut::cache_eviction policy)
+{
+    ut::lru_cache<file_key, size_t, file_key_hash> cache({.capacity = 256, .shards = 8, .policy = policy});
+    assert(cache.shard_count() == 8 && cache.capacity() == 256);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t]() {
+            std::mt19937 rng(t);
+            for (int i = 0; i < 20000; ++i) {
+                file_key key{"img/" + std::to_string(rng() % 512) + ".png", 0};
+                key.size       = key.path.size();
+                const size_t v = cache.get_or_compute(key, [&]() { return key.size * 2; });
+                assert(v == key.size * 2);
+                if (i % 16 == 0) {
+                    cache.erase(key);
+                }
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    auto s = cache.statistics();
+    assert(s.hits + s.misses + s.coalesced == 80000);
+    assert(s.cost <= cache.capacity() && s.entries == s.cost);
+    assert(s.evictions > 0);
+}
+
+int main()
+{
+    testLru();
+    testCost();
+    testClock();
+    testCoalescing();
+    testConcurrent(ut::cache_eviction::lru);
+    testConcurrent(ut::cache_eviction::clock);
+    std::cout << "lru_cache ok" << std::endl;
+    return 0;
+}
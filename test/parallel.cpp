@@ -0,0 +1,121 @@
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "utility.cc/parallel.h"
+
+
+void testParallelFor()
+{
+    std::vector<int> values(100'000, 1);
+
+    ut::parallel_for(values, [](int &v) { v *= 2; });
+    for (int v : values) {
+        assert(v == 2);
+    }
+
+    // enumerated: every element still sees its own index
+    ut::parallel_for(values | ut::enumerate, [](auto &&item) {
+        auto &&[index, value] = item;
+        value                 = static_cast<int>(index);
+    });
+    for (size_t i = 0; i < values.size(); ++i) {
+        assert(values[i] == static_cast<int>(i));
+    }
+
+    std::atomic<size_t> sum{0};
+    ut::parallel_for(10, 1010, [&](size_t i) { sum += i; }, {.grain = 7});
+    assert(sum == (10 + 1009) * 1000 / 2);
+
+    std::cout << "parallel_for ok" << std::endl;
+}
+
+void testParallelTransformReduce()
+{
+    std::vector<int>     in(12345);
+    std::vector<int64_t> out(in.size());
+    std::iota(in.begin(), in.end(), 0);
+
+    ut::parallel_transform(in, out, [](int v) { return int64_t(v) * v; });
+    for (size_t i = 0; i < in.size(); ++i) {
+        assert(out[i] == int64_t(i) * int64_t(i));
+    }
+
+    int64_t total = ut::parallel_reduce(out, int64_t(0), [](int64_t a, int64_t b) { return a + b; });
+    assert(total == std::accumulate(out.begin(), out.end(), int64_t(0)));
+
+    // non commutative combine: chunks are joined in order
+    std::vector<std::string> words(1000, "a");
+    words[0]        = "first";
+    words.back()    = "last";
+    std::string cat = ut::parallel_reduce(
+        words, std::string(), [](const std::string &s) { return s; }, [](std::string a, const std::string &b) { return a + b; }, {.grain = 16});
+    assert(cat.starts_with("firsta") && cat.ends_with("alast") && cat.size() == 5 + 998 + 4);
+
+    size_t index_sum = ut::parallel_reduce(
+        in | ut::enumerate, size_t(0), [](auto &&item) { return item.index; }, [](size_t a, size_t b) { return a + b; });
+    assert(index_sum == in.size() * (in.size() - 1) / 2);
+
+    std::cout << "parallel_transform/reduce ok" << std::endl;
+}
+
+void testException()
+{
+    std::vector<int> values(1000);
+    bool             bThrown = false;
+    try {
+        ut::parallel_for(values | ut::enumerate, [](auto &&item) {
+            if (item.index == 500) {
+                throw std::runtime_error("boom");
+            }
+        });
+    }
+    catch (const std::runtime_error &) {
+        bThrown = true;
+    }
+    assert(bThrown);
+
+    // still usable afterwards
+    std::atomic<int> n{0};
+    ut::parallel_for(values, [&](int &) { ++n; });
+    assert(n == 1000);
+
+    std::cout << "exception propagation ok" << std::endl;
+}
+
+void testOwnScheduler()
+{
+    // explicit workers, the global scheduler may have none on a single core machine
+    ut::job_system       jobs(4);
+    ut::parallel_options opt{.grain = 64, .scheduler = &jobs};
+
+    for (int round = 0; round < 50; ++round) {
+        std::vector<uint32_t> values(20'000);
+        ut::parallel_for(values | ut::enumerate, [](auto &&item) { item.value = uint32_t(item.index * 3); }, opt);
+
+        uint64_t sum = ut::parallel_reduce(values, uint64_t(0), [](uint64_t a, uint64_t b) { return a + b; }, opt);
+        assert(sum == uint64_t(3) * values.size() * (values.size() - 1) / 2);
+    }
+
+    // nested calls: the waiting thread helps instead of dead locking
+    std::atomic<int> n{0};
+    ut::parallel_for(0, 8, [&](size_t) { ut::parallel_for(0, 100, [&](size_t) { ++n; }, {.grain = 1, .scheduler = &jobs}); }, {.grain = 1, .scheduler = &jobs});
+    assert(n == 800);
+
+    std::cout << "own scheduler ok" << std::endl;
+}
+
+int main()
+{
+    std::cout << "concurrency: " << ut::job_system::global().concurrency() << std::endl;
+    testParallelFor();
+    testParallelTransformReduce();
+    testException();
+    testOwnScheduler();
+    return 0;
+}
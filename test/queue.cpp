@@ -0,0 +1,273 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "utility.cc/queue.h"
+
+
+struct counted
+{
+    static inline int alive = 0;
+    int               value = 0;
+
+    counted(int v = 0) : value(v) { ++alive; }
+    counted(const counted &o) : value(o.value) { ++alive; }
+    counted &operator=(const counted &) = default;
+    ~counted() { --alive; }
+};
+
+template <typename Queue>
+void testBasics()
+{
+    {
+        Queue q(5);
+        assert(q.capacity() == 8 && q.empty());
+
+        for (int i = 0; i < 8; ++i) {
+            assert(q.try_push(counted(i)));
+        }
+        assert(!q.try_push(counted(8)) && q.size_approx() == 8);
+
+        auto v = q.try_pop();
+        assert(v && v->value == 0);
+
+        // batches wrap around the end of the ring, a full batch only pushes what fits
+        std::vector<counted> in = {10, 11, 12};
+        assert(q.try_push_batch(in.begin(), in.end()) == 1);
+        std::vector<counted> out;
+        assert(q.try_pop_batch(std::back_inserter(out), 100) == 8);
+        assert(out.front().value == 1 && out.back().value == 10);
+        assert(!q.try_pop() && q.try_pop_batch(std::back_inserter(out), 4) == 0);
+
+        assert(q.try_push_batch(in.begin(), in.end()) == 3);
+    }
+    // elements left in the queue are destroyed with it
+    assert(counted::alive == 0);
+}
+
+// throws when built from a negative int or when 13 is assigned
+struct picky
+{
+    static inline int alive = 0;
+    int               value = 0;
+
+    picky(int v) : value(v)
+    {
+        if (v < 0) {
+            throw std::runtime_error("negative");
+        }
+        ++alive;
+    }
+    picky(const picky &o) : value(o.value) { ++alive; }
+    picky &operator=(const picky &o)
+    {
+        if (o.value == 13) {
+            throw std::runtime_error("13");
+        }
+        value = o.value;
+        return *this;
+    }
+    ~picky() { --alive; }
+};
+
+template <typename Queue>
+void testExceptions()
+{
+    constexpr bool bSpsc = std::is_same_v<Queue, ut::spsc_queue<picky>>;
+    {
+        Queue              q(8);
+        std::vector<picky> out(8, picky(0));
+        bool               bThrown = false;
+
+        // the elements built before the throw are pushed
+        std::vector<int> in = {1, 2, -3, 4};
+        try {
+            q.try_push_batch(in.begin(), in.end());
+        }
+        catch (const std::runtime_error &) {
+            bThrown = true;
+        }
+        assert(bThrown && q.try_pop_batch(out.begin(), 8) == 2 && out[0].value == 1 && out[1].value == 2);
+
+        bThrown = false;
+        try {
+            q.try_emplace(-1);
+        }
+        catch (const std::runtime_error &) {
+            bThrown = true;
+        }
+        assert(bThrown && !q.try_pop());
+
+        // no slot is lost, the whole capacity is usable again
+        for (int i = 0; i < 8; ++i) {
+            assert(q.try_push(picky(i == 2 ? 13 : i)));
+        }
+        bThrown = false;
+        try {
+            q.try_pop_batch(out.begin(), 4);
+        }
+        catch (const std::runtime_error &) {
+            bThrown = true;
+        }
+        // spsc keeps the element that failed queued, mpmc drops the rest of the run it had claimed
+        assert(bThrown && out[0].value == 0 && out[1].value == 1);
+        assert(q.size_approx() == (bSpsc ? 6 : 4));
+        assert(q.try_push(picky(20)) && q.try_push(picky(21)));
+        if constexpr (bSpsc) {
+            assert(q.try_pop()->value == 13);
+        }
+        else {
+            assert(q.try_pop()->value == 4);
+        }
+    }
+    assert(picky::alive == 0);
+}
+
+void testMoveOnly()
+{
+    ut::spsc_queue<std::unique_ptr<int>> spsc(4);
+    spsc.try_emplace(std::make_unique<int>(1));
+    assert(**spsc.try_pop() == 1);
+
+    ut::mpmc_queue<std::unique_ptr<int>> mpmc(4);
+    std::vector<std::unique_ptr<int>> in;
+    in.push_back(std::make_unique<int>(2));
+    in.push_back(std::make_unique<int>(3));
+    assert(mpmc.try_push_batch(std::make_move_iterator(in.begin()), std::make_move_iterator(in.end())) == 2);
+    assert(!in[0] && **mpmc.try_pop() == 2);
+}
+
+void testSpscThreads()
+{
+    constexpr int             N = 200000;
+    ut::spsc_queue<int>       q(64);
+    ut::spsc_queue<int, true> w(16);
+
+    std::thread producer([&]() {
+        int batch[7];
+        for (int i = 0; i < N;) {
+            // singles and batches mixed, order is kept either way
+            if (i % 3 == 0) {
+                std::iota(std::begin(batch), std::end(batch), i);
+                i += static_cast<int>(q.try_push_batch(std::begin(batch), std::begin(batch) + std::min(7, N - i)));
+            }
+            else if (q.try_push(i)) {
+                ++i;
+            }
+            else {
+                std::this_thread::yield();
+            }
+        }
+        for (int i = 0; i < N; ++i) {
+            w.push(i);
+        }
+    });
+
+    for (int expected = 0; expected < N;) {
+        if (auto v = q.try_pop()) {
+            assert(*v == expected);
+            ++expected;
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+    std::vector<int> got;
+    while (got.size() < N) {
+        w.pop_batch(std::back_inserter(got), 5);
+    }
+    producer.join();
+    for (int i = 0; i < N; ++i) {
+        assert(got[i] == i);
+    }
+}
+
+template <bool bWaitable>
+void testMpmcThreads()
+{
+    constexpr int threads = 4;
+    constexpr int N       = 50000; // per producer
+
+    ut::mpmc_queue<int, bWaitable> q(128);
+    std::atomic<long long>         sum{0};
+    std::atomic<int>               count{0};
+    std::vector<std::thread>       pool;
+
+    for (int p = 0; p < threads; ++p) {
+        pool.emplace_back([&, p]() {
+            std::vector<int> batch;
+            for (int i = 0; i < N;) {
+                int v = p * N + i + 1;
+                if (i % 2) {
+                    batch.assign({v});
+                    if (i + 1 < N) {
+                        batch.push_back(v + 1);
+                    }
+                    i += static_cast<int>(q.try_push_batch(batch.begin(), batch.end()));
+                }
+                else if constexpr (bWaitable) {
+                    q.push(v);
+                    ++i;
+                }
+                else if (q.try_push(v)) {
+                    ++i;
+                }
+                if (i % 64 == 0) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (int c = 0; c < threads; ++c) {
+        pool.emplace_back([&, c]() {
+            std::vector<int> got;
+            // blocking consumers take exactly N each, so none of them sleeps forever at the end
+            for (size_t taken = 0; bWaitable ? taken < N : count.load() < threads * N;) {
+                got.clear();
+                size_t n = 0;
+                if constexpr (bWaitable) {
+                    n = q.pop_batch(std::back_inserter(got), std::min<size_t>(c % 2 ? 3 : 1, N - taken));
+                }
+                else if (!(n = q.try_pop_batch(std::back_inserter(got), c % 2 ? 3 : 1))) {
+                    std::this_thread::yield();
+                }
+                for (int v : got) {
+                    sum += v;
+                }
+                taken += n;
+                count += static_cast<int>(n);
+            }
+        });
+    }
+    for (auto &t : pool) {
+        t.join();
+    }
+
+    const long long total = static_cast<long long>(threads) * N;
+    assert(count == total && sum == total * (total + 1) / 2);
+    assert(q.empty());
+}
+
+int main()
+{
+    testBasics<ut::spsc_queue<counted>>();
+    testBasics<ut::mpmc_queue<counted>>();
+    testBasics<ut::mpmc_queue<counted, true>>();
+    testExceptions<ut::spsc_queue<picky>>();
+    testExceptions<ut::mpmc_queue<picky>>();
+    testExceptions<ut::mpmc_queue<picky, true>>();
+    testMoveOnly();
+    testSpscThreads();
+    testMpmcThreads<false>();
+    testMpmcThreads<true>();
+    std::cout << "queue ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,143 @@
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include "utility.cc/rope.h"
+
+
+void testAppend()
+{
+    ut::rope r;
+    assert(r.empty() && r.flatten().empty());
+
+    // consecutive arena appends share one piece
+    r.append("hello").append(", ");
+    r += "world";
+    assert(r.size() == 12 && r.piece_count() == 1);
+    assert(r.flatten() == "hello, world");
+    assert(r.at(7) == 'w');
+
+    // borrowed views are referenced, not copied
+    const std::string tail = "!!";
+    r.borrow(tail);
+    bool bFound = false;
+    r.for_each_piece([&](std::string_view piece) { bFound |= piece.data() == tail.data(); });
+    assert(bFound);
+
+    std::string out = ">";
+    r.flatten_into(out);
+    assert(out == ">hello, world!!");
+
+    // a piece larger than a block goes to a block of its own
+    const std::string big(200000, 'x');
+    r.append(big);
+    r.append("y");
+    assert(r.size() == 14 + 200001 && r.flatten() == "hello, world!!" + big + "y");
+
+    ut::rope moved = std::move(r);
+    assert(moved.size() == 14 + 200001);
+    r.append("reuse"); // NOLINT(bugprone-use-after-move): a moved-from rope is empty and usable
+    assert(r.flatten() == "reuse");
+
+    moved.clear();
+    assert(moved.empty() && moved.piece_count() == 0);
+}
+
+void testEdits()
+{
+    ut::rope r;
+    r.append("0123456789");
+    r.insert(5, "abc");
+    assert(r.flatten() == "01234abc56789");
+    r.erase(3, 6);
+    assert(r.flatten() == "0126789");
+    r.replace(0, 3, "XY");
+    assert(r.flatten() == "XY6789");
+    r.insert(100, "END"); // clamped
+    r.erase(4, 1000);
+    assert(r.flatten() == "XY67");
+    r.erase(0, r.size());
+    assert(r.empty());
+    r.insert_borrowed(0, "again");
+    assert(r.flatten() == "again");
+
+    // random edits against std::string, enough pieces to spread over many leaves
+    std::mt19937 rng(42);
+    std::string  ref;
+    ut::rope     rope;
+    for (int i = 0; i < 20000; ++i) {
+        const size_t pos = ref.empty() ? 0 : rng() % (ref.size() + 1);
+        std::string  text(1 + rng() % 8, static_cast<char>('a' + rng() % 26));
+        switch (rng() % 4) {
+        case 0:
+            rope.append(text);
+            ref += text;
+            break;
+        case 1:
+            rope.insert(pos, text);
+            ref.insert(pos, text);
+            break;
+        case 2:
+        {
+            const size_t n = rng() % 12;
+            rope.erase(pos, n);
+            ref.erase(std::min(pos, ref.size()), n);
+            break;
+        }
+        default:
+        {
+            const size_t n = rng() % 6;
+            rope.replace(pos, n, text);
+            ref.replace(std::min(pos, ref.size()), n, text);
+            break;
+        }
+        }
+        assert(rope.size() == ref.size());
+        if (i % 997 == 0) {
+            assert(rope.flatten() == ref);
+            if (!ref.empty()) {
+                assert(rope.at(pos % ref.size()) == ref[pos % ref.size()]);
+            }
+        }
+    }
+    assert(rope.flatten() == ref);
+    assert(rope.piece_count() > 64);
+}
+
+void testWrite()
+{
+    auto path = std::filesystem::temp_directory_path() / "ut_test_rope.txt";
+
+    // more pieces than one writev call takes
+    ut::rope    r;
+    std::string ref;
+    for (int i = 0; i < 5000; ++i) {
+        std::string line = "line " + std::to_string(i) + "\n";
+        r.insert(0, line);
+        ref.insert(0, line);
+    }
+    assert(r.piece_count() > 1024);
+    assert(r.write_to(path));
+
+    std::ifstream      f(path, std::ios::binary);
+    std::ostringstream ss;
+    ss << f.rdbuf();
+    assert(ss.str() == ref);
+    f.close();
+    std::filesystem::remove(path);
+
+    assert(!r.write_to(path / "missing_dir" / "x.txt"));
+}
+
+int main()
+{
+    testAppend();
+    testEdits();
+    testWrite();
+    std::cout << "rope ok" << std::endl;
+    return 0;
+}
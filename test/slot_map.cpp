@@ -0,0 +1,168 @@
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "utility.cc/ranges.h"
+#include "utility.cc/slot_map.h"
+
+
+void testBasics()
+{
+    ut::slot_map<std::string> names;
+    auto                      a = names.insert("a");
+    auto                      b = names.emplace(3, 'b');
+    auto                      c = names.insert(std::string("c"));
+    assert(names.size() == 3);
+    assert(*names.get(b) == "bbb" && names[a] == "a" && names.at(c) == "c");
+    assert(!ut::slot_map<std::string>::handle{} && a);
+
+    // swap and pop: c moves into a's place, its handle still resolves
+    assert(names.erase(a));
+    assert(!names.erase(a));
+    assert(names.size() == 2 && names.values()[0] == "c");
+    assert(names[c] == "c" && !names.get(a) && !names.contains(a));
+
+    // the freed slot is reused with a new generation, the old handle stays stale
+    auto d = names.insert("d");
+    assert(d.index() == a.index() && d.generation() != a.generation());
+    assert(!names.get(a) && names[d] == "d");
+
+    bool bThrew = false;
+    try {
+        names.at(a);
+    }
+    catch (const std::out_of_range &) {
+        bThrew = true;
+    }
+    assert(bThrew);
+
+    // dense iteration, with the handle of each value
+    for (auto [i, value] : ut::enumerate(names)) {
+        assert(names.get(names.handle_at(i)) == &value);
+    }
+
+    names.clear();
+    assert(names.empty() && !names.get(b) && !names.get(c) && !names.get(d));
+    auto e = names.insert("e");
+    assert(names.size() == 1 && names[e] == "e");
+}
+
+void testRetiredSlot()
+{
+    // 6 index bits + 2 generation bits: generations 1..3, then the slot is retired
+    using tiny = ut::slot_handle<uint8_t, 6>;
+    ut::slot_map<int, tiny> m;
+
+    auto h = m.insert(0);
+    assert(h.index() == 0 && h.generation() == 1);
+    m.erase(h);
+    h = m.insert(1);
+    assert(h.index() == 0 && h.generation() == 2);
+    m.erase(h);
+    h = m.insert(2);
+    assert(h.index() == 0 && h.generation() == 3);
+    m.erase(h);
+    h = m.insert(3);
+    assert(h.index() == 1); // slot 0 never comes back
+
+    for (int i = 2; i < 63; ++i) {
+        m.insert(i);
+    }
+    bool bThrew = false;
+    try {
+        m.insert(63); // index 63 is the free list terminator
+    }
+    catch (const std::length_error &) {
+        bThrew = true;
+    }
+    assert(bThrew);
+}
+
+// throws from its constructor when asked to
+struct fragile
+{
+    int value = 0;
+
+    explicit fragile(int v) : value(v)
+    {
+        if (v < 0) {
+            throw std::runtime_error("fragile");
+        }
+    }
+};
+
+void testThrowingConstructor()
+{
+    ut::slot_map<fragile> m;
+    auto                  a = m.emplace(1);
+
+    bool bThrew = false;
+    try {
+        m.emplace(-1);
+    }
+    catch (const std::runtime_error &) {
+        bThrew = true;
+    }
+    assert(bThrew && m.size() == 1 && m.get(a)->value == 1);
+
+    // the slot it took goes back unused: same index, same generation, and nothing but `a` resolves
+    ut::slot_handle32 phantom(1, 1);
+    assert(!m.contains(phantom));
+    auto b = m.emplace(2);
+    assert(b == phantom && m.get(b)->value == 2 && m.size() == 2);
+    assert(m.erase(a) && m.erase(b) && m.empty());
+}
+
+void testRandomAgainstMap()
+{
+    ut::slot_map<std::unique_ptr<int>, ut::slot_handle64> m;
+    std::unordered_map<uint64_t, int>                     ref;
+    std::vector<ut::slot_handle64>                        stale;
+    std::mt19937                                          rng(7);
+
+    for (int i = 0; i < 20000; ++i) {
+        if (ref.empty() || rng() % 3) {
+            auto h = m.insert(std::make_unique<int>(i));
+            assert(!ref.contains(h.bits));
+            ref[h.bits] = i;
+        }
+        else {
+            auto it = ref.begin();
+            std::advance(it, rng() % ref.size());
+            ut::slot_handle64 h;
+            h.bits = it->first;
+            assert(m.erase(h));
+            stale.push_back(h);
+            ref.erase(it);
+        }
+    }
+
+    assert(m.size() == ref.size());
+    for (auto [bits, value] : ref) {
+        ut::slot_handle64 h;
+        h.bits = bits;
+        assert(**m.get(h) == value);
+    }
+    for (auto h : stale) {
+        assert(!m.get(h));
+    }
+    for (size_t i = 0; i < m.size(); ++i) {
+        assert(ref.at(m.handle_at(i).bits) == *m.values()[i]);
+    }
+}
+
+int main()
+{
+    testBasics();
+    testRetiredSlot();
+    testThrowingConstructor();
+    testRandomAgainstMap();
+
+    std::cout << "slot_map ok" << std::endl;
+    return 0;
+}
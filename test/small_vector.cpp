@@ -0,0 +1,159 @@
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "utility.cc/small_vector.h"
+#include "utility.cc/string_utils.h"
+
+
+// counts live instances so leaks and double destroys show up
+struct Tracked
+{
+    static int live;
+    int        value;
+
+    Tracked(int v) : value(v) { ++live; }
+    Tracked(const Tracked &o) : value(o.value) { ++live; }
+    Tracked(Tracked &&o) noexcept : value(o.value) { ++live; }
+    Tracked &operator=(const Tracked &) = default;
+    Tracked &operator=(Tracked &&)      = default;
+    ~Tracked() { --live; }
+
+    bool operator==(const Tracked &o) const { return value == o.value; }
+};
+int Tracked::live = 0;
+
+void testInlineAndSpill()
+{
+    {
+        ut::small_vector<Tracked, 3> v;
+        v.emplace_back(1);
+        v.emplace_back(2);
+        v.emplace_back(3);
+        assert(!v.on_heap() && v.size() == 3 && Tracked::live == 3);
+
+        v.push_back(v[0]); // aliasing an element while growing
+        assert(v.on_heap() && v.size() == 4 && v.back().value == 1 && Tracked::live == 4);
+
+        v.erase(v.begin() + 1);
+        assert(v.size() == 3 && v[1].value == 3 && Tracked::live == 3);
+
+        v.insert(v.begin(), Tracked(0));
+        assert(v.front().value == 0 && v.size() == 4);
+
+        v.resize(1, Tracked(9));
+        assert(v.size() == 1 && Tracked::live == 1);
+    }
+    assert(Tracked::live == 0);
+}
+
+void testMoveAndCopy()
+{
+    ut::small_vector<std::unique_ptr<int>, 2> a;
+    a.push_back(std::make_unique<int>(1));
+    auto b = std::move(a);
+    assert(a.empty() && !a.on_heap() && *b[0] == 1);
+
+    b.push_back(std::make_unique<int>(2));
+    b.push_back(std::make_unique<int>(3));
+    auto *heap = b.data();
+    auto  c    = std::move(b);
+    assert(c.on_heap() && c.data() == heap && b.empty() && !b.on_heap());
+    b.push_back(std::make_unique<int>(4));
+    assert(*b[0] == 4);
+
+    ut::small_vector<std::string, 2> s = {"a", "b", "c"};
+    auto                             t = s;
+    assert(t == s && t.size() == 3);
+    t = {"x"};
+    assert(t.size() == 1 && t[0] == "x" && s.size() == 3);
+}
+
+// the move may throw, so growth copies; the copy throws once the budget runs out
+struct Brittle
+{
+    static int live;
+    static int copies_left;
+    int        value;
+
+    Brittle(int v) : value(v) { ++live; }
+    Brittle(const Brittle &o) : value(o.value)
+    {
+        if (copies_left-- == 0) {
+            throw std::runtime_error("copy");
+        }
+        ++live;
+    }
+    Brittle(Brittle &&o) : value(o.value) { ++live; }
+    ~Brittle() { --live; }
+};
+int Brittle::live        = 0;
+int Brittle::copies_left = 0;
+
+void testStrongGuarantee()
+{
+    {
+        Brittle::copies_left = 100;
+        ut::small_vector<Brittle, 2> v;
+        v.emplace_back(1);
+        v.emplace_back(2);
+        v.reserve(4); // inline to heap
+        v.emplace_back(3);
+        v.emplace_back(4);
+        assert(v.on_heap() && Brittle::live == 4);
+
+        // growth fails on the third copy: nothing leaks and v is as it was, same buffer included
+        const Brittle *data = v.data();
+        for (int fail : {0, 2}) {
+            Brittle::copies_left = fail;
+            bool bThrew          = false;
+            try {
+                v.emplace_back(5);
+            }
+            catch (const std::runtime_error &) {
+                bThrew = true;
+            }
+            assert(bThrew && v.size() == 4 && v.data() == data && Brittle::live == 4);
+            for (int i = 0; i < 4; ++i) {
+                assert(v[i].value == i + 1);
+            }
+        }
+
+        Brittle::copies_left = 1;
+        bool bThrew          = false;
+        try {
+            v.reserve(100);
+        }
+        catch (const std::runtime_error &) {
+            bThrew = true;
+        }
+        assert(bThrew && v.capacity() == 4 && Brittle::live == 4);
+
+        Brittle::copies_left = 100;
+        v.emplace_back(5);
+        assert(v.size() == 5 && v[4].value == 5 && Brittle::live == 5);
+    }
+    assert(Brittle::live == 0);
+}
+
+void testSplitView()
+{
+    auto kv = ut::str::split_view<2>("key=value", '=');
+    assert(!kv.on_heap() && kv.size() == 2 && kv[0] == "key" && kv[1] == "value");
+
+    auto many = ut::str::split_view<2>("a b c d", ' ');
+    assert(many.on_heap() && many.size() == 4 && many[3] == "d");
+}
+
+int main()
+{
+    testInlineAndSpill();
+    testMoveAndCopy();
+    testStrongGuarantee();
+    testSplitView();
+    std::cout << "small_vector ok" << std::endl;
+    return 0;
+}
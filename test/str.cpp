@@ -1,8 +1,172 @@
 
 
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
 #include "utility.cc/string_utils.h"
 
 
+void test_inline_string()
+{
+    static_assert(std::is_trivially_copyable_v<ut::inline_string<15>>);
+    static_assert(!std::is_trivially_copyable_v<ut::inline_string<15, ut::inline_overflow::heap>>);
+
+    ut::inline_string<8> s = "key";
+    s += "=v";
+    assert(s == "key=v" && s.size() == 5 && std::string_view(s.c_str()) == "key=v");
+
+    bool bThrown = false;
+    try {
+        s += "too long";
+    }
+    catch (const std::length_error &) {
+        bThrown = true;
+    }
+    assert(bThrown);
+
+    ut::inline_string<4, ut::inline_overflow::truncate> t = "truncated";
+    assert(t == "trun");
+
+    ut::inline_string<4, ut::inline_overflow::heap> h = "abc";
+    assert(!h.on_heap());
+    h += "defgh";
+    assert(h.on_heap() && h == "abcdefgh");
+    auto copy  = h;
+    auto moved = std::move(h);
+    assert(copy == "abcdefgh" && moved == "abcdefgh" && h.empty());
+
+    // views of the string's own chars, also when the append moves it to a bigger heap buffer
+    ut::inline_string<4, ut::inline_overflow::heap> b("abcdefgh");
+    b.append(b.view());
+    assert(b == "abcdefghabcdefgh");
+    b = b.view().substr(3, 5);
+    assert(b == "defgh");
+    ut::inline_string<8> a = "abc";
+    a.append(a.view());
+    assert(a == "abcabc");
+    a = a.view().substr(2);
+    assert(a == "cabc");
+    static_assert([] {
+        ut::inline_string<8> c = "xy";
+        c.append(c.view());
+        c = c.view().substr(1, 2);
+        return c == "yx";
+    }());
+
+    std::vector<ut::inline_string<16>> parts;
+    ut::str::split("a,bb,,ccc", ',', parts);
+    assert(parts.size() == 4 && parts[0] == "a" && parts[1] == "bb" && parts[2].empty() && parts[3] == "ccc");
+
+    std::vector<std::string_view> views;
+    ut::str::split("x y", ' ', views);
+    assert(views.size() == 2 && views[1] == "y");
+
+    ut::inline_string<32> lower, upper, joined;
+    ut::str::toLower("Content-Type", lower);
+    ut::str::toUpper("Content-Type", upper);
+    assert(lower == "content-type" && upper == "CONTENT-TYPE");
+
+    std::vector<std::string_view> path = {"usr", "local", "bin"};
+    ut::str::concat(path, "/", joined);
+    assert(joined == "usr/local/bin");
+}
+
+void test_numbers()
+{
+    using ut::str::parse;
+
+    assert(parse<int>("0") == 0);
+    assert(parse<int>("-42") == -42);
+    assert(parse<int>("2147483647") == std::numeric_limits<int>::max());
+    assert(parse<int>("-2147483648") == std::numeric_limits<int>::min());
+    assert(!parse<int>("2147483648"));
+    assert(parse<int64_t>("-9223372036854775808") == std::numeric_limits<int64_t>::min());
+    assert(parse<uint64_t>("18446744073709551615") == std::numeric_limits<uint64_t>::max());
+    assert(!parse<uint64_t>("18446744073709551616"));
+    assert(parse<uint32_t>("0000000000000000000123") == 123u);
+    assert(parse<uint64_t>("1234567890123456") == 1234567890123456ull);
+    assert(!parse<unsigned>("-1"));
+    assert(!parse<int>("") && !parse<int>("-") && !parse<int>("12a") && !parse<int>(" 1") && !parse<int>("1234567x"));
+    assert(!parse<uint8_t>("256") && parse<uint8_t>("255") == 255);
+
+    assert(parse<double>("1.5") == 1.5 && parse<double>("-2e3") == -2000.0);
+    assert(!parse<double>("1.5x") && !parse<double>(""));
+
+    std::vector<int> ints;
+    assert(ut::str::parse_column("1,-2,30,", ',', ints));
+    assert((ints == std::vector<int>{1, -2, 30}));
+    ints.clear();
+    assert(!ut::str::parse_column("1,,3", ',', ints) && ints.size() == 1);
+
+    char buf[32];
+    assert(ut::str::format_to(std::span<char>(buf), -1234) == "-1234");
+    assert(ut::str::format_to(std::span<char>(buf), 0.1) == "0.1");
+    assert(ut::str::format_to(std::span<char>(buf, 2), 12345).empty());
+
+    ut::inline_string<24> s;
+    ut::str::format_to(s, uint64_t(42));
+    assert(s == "42");
+}
+
+void test_search()
+{
+    // small alphabet so needles hit often, lengths around the 64 byte block edges
+    std::mt19937 rng(42);
+    auto         random_text = [&](size_t n) {
+        std::string s(n, 'a');
+        for (char &c : s) {
+            c = "ab e\n"[rng() % 5];
+        }
+        return s;
+    };
+
+    for (int round = 0; round < 300; ++round) {
+        std::string haystack = random_text(rng() % 300);
+        std::string needle   = random_text(rng() % 6);
+        for (size_t pos : {size_t(0), size_t(1), size_t(63), haystack.size(), haystack.size() + 1}) {
+            size_t expected = std::string_view(haystack).find(needle, pos);
+            assert(ut::str::find(haystack, needle, pos) == expected);
+            assert(ut::str::searcher(needle).find(haystack, pos) == expected);
+        }
+    }
+
+    std::string text = std::string(1000, ' ') + "needle at the end";
+    assert(ut::str::find(text, "needle") == 1000);
+    assert(ut::str::searcher("the end").find(text) == text.size() - 7);
+    assert(ut::str::searcher("missing").find(text) == std::string_view::npos);
+
+    // multi needle against a brute force scan
+    for (int round = 0; round < 100; ++round) {
+        std::string      haystack = random_text(rng() % 500);
+        std::string      p0 = random_text(1 + rng() % 4), p1 = random_text(1 + rng() % 4), p2 = random_text(rng() % 3);
+        std::string_view patterns[] = {p0, p1, p2};
+
+        std::vector<ut::str::multi_searcher::match> expected;
+        for (size_t i = 0; i < haystack.size(); ++i) {
+            for (uint32_t k = 0; k < 3; ++k) {
+                if (!patterns[k].empty() && std::string_view(haystack).substr(i).starts_with(patterns[k])) {
+                    expected.push_back({i, k});
+                }
+            }
+        }
+        assert(ut::str::multi_searcher(patterns).find_all(haystack) == expected);
+    }
+
+    ut::str::multi_searcher markers({"ERROR", "WARN"});
+    auto                    found = markers.find_all("ok\nWARN: low disk\nERROR: full\nWARNING");
+    assert(found.size() == 3 && found[0].pattern == 1 && found[1].pattern == 0 && found[2].offset == 30);
+
+    assert(ut::str::replace("a.b.c", ".", "::") == "a::b::c");
+    assert(ut::str::replace("aaaa", "aa", "a") == "aa");
+    assert(ut::str::replace("abc", "", "x") == "abc");
+    assert(ut::str::left("key=value", "=") == "key");
+}
 
 int main()
 {
@@ -10,4 +174,13 @@ int main()
 
     auto ret = ut::str::trim(a);
     printf("%s\n", ret.data());
-}
\ No newline at end of file
+
+    test_inline_string();
+    printf("inline_string ok\n");
+
+    test_numbers();
+    printf("numbers ok\n");
+
+    test_search();
+    printf("search ok\n");
+}
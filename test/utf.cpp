@@ -0,0 +1,160 @@
+#include <cassert>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "utility.cc/file_utils.h"
+#include "utility.cc/utf.h"
+
+
+// Unicode Table 3-7, well-formed UTF-8 byte sequences
+static bool reference_valid(const std::string &s)
+{
+    auto in = [](unsigned char c, int lo, int hi) { return c >= lo && c <= hi; };
+    for (size_t i = 0; i < s.size();) {
+        const unsigned char *p = reinterpret_cast<const unsigned char *>(s.data()) + i;
+        const size_t         n = s.size() - i;
+        size_t               len;
+        if (p[0] <= 0x7F) {
+            len = 1;
+        }
+        else if (in(p[0], 0xC2, 0xDF)) {
+            len = n >= 2 && in(p[1], 0x80, 0xBF) ? 2 : 0;
+        }
+        else if (p[0] == 0xE0) {
+            len = n >= 3 && in(p[1], 0xA0, 0xBF) && in(p[2], 0x80, 0xBF) ? 3 : 0;
+        }
+        else if (in(p[0], 0xE1, 0xEC) || in(p[0], 0xEE, 0xEF)) {
+            len = n >= 3 && in(p[1], 0x80, 0xBF) && in(p[2], 0x80, 0xBF) ? 3 : 0;
+        }
+        else if (p[0] == 0xED) {
+            len = n >= 3 && in(p[1], 0x80, 0x9F) && in(p[2], 0x80, 0xBF) ? 3 : 0;
+        }
+        else if (p[0] == 0xF0) {
+            len = n >= 4 && in(p[1], 0x90, 0xBF) && in(p[2], 0x80, 0xBF) && in(p[3], 0x80, 0xBF) ? 4 : 0;
+        }
+        else if (in(p[0], 0xF1, 0xF3)) {
+            len = n >= 4 && in(p[1], 0x80, 0xBF) && in(p[2], 0x80, 0xBF) && in(p[3], 0x80, 0xBF) ? 4 : 0;
+        }
+        else if (p[0] == 0xF4) {
+            len = n >= 4 && in(p[1], 0x80, 0x8F) && in(p[2], 0x80, 0xBF) && in(p[3], 0x80, 0xBF) ? 4 : 0;
+        }
+        else {
+            len = 0;
+        }
+        if (!len) {
+            return false;
+        }
+        i += len;
+    }
+    return true;
+}
+
+static char32_t random_code_point(std::mt19937 &rng)
+{
+    switch (rng() % 4) {
+    case 0: return rng() % 0x80;
+    case 1: return 0x80 + rng() % (0x800 - 0x80);
+    case 2: {
+        char32_t cp = 0x800 + rng() % (0x10000 - 0x800);
+        return cp >= 0xD800 && cp <= 0xDFFF ? U'中' : cp;
+    }
+    default: return 0x10000 + rng() % (0x110000 - 0x10000);
+    }
+}
+
+void testValidate()
+{
+    assert(ut::utf::validate(""));
+    assert(ut::utf::validate("plain ascii"));
+    assert(ut::utf::validate("所有测试通过 ✓ 😀"));
+    assert(!ut::utf::validate("\xC0\xAF"));         // overlong '/'
+    assert(!ut::utf::validate("\xE0\x80\xAF"));     // overlong
+    assert(!ut::utf::validate("\xED\xA0\x80"));     // surrogate U+D800
+    assert(!ut::utf::validate("\xF4\x90\x80\x80")); // U+110000
+    assert(!ut::utf::validate("\xF8\x88\x80\x80\x80"));
+    assert(!ut::utf::validate("ab\xE4\xB8"));       // cut off at the end
+    assert(!ut::utf::validate("\x80"));
+
+    // every error class at every position relative to the 16/64 byte blocks
+    std::mt19937 rng(1);
+    for (int round = 0; round < 20000; ++round) {
+        std::u32string cps;
+        std::string    s;
+        size_t         n = rng() % 150;
+        while (s.size() < n) {
+            char32_t cp = random_code_point(rng);
+            cps += cp;
+            s += *ut::utf::from_utf32(std::u32string(1, cp));
+        }
+        assert(ut::utf::validate(s));
+        assert(ut::utf::count_code_points(s) == cps.size());
+
+        if (!s.empty() && round % 2) {
+            for (int k = 1 + rng() % 3; k > 0; --k) {
+                s[rng() % s.size()] = static_cast<char>(rng());
+            }
+        }
+        if (round % 7 == 0 && !s.empty()) {
+            s.resize(rng() % s.size()); // truncate, often mid sequence
+        }
+        const bool bValid = reference_valid(s);
+        assert(ut::utf::validate(s) == bValid);
+        const size_t prefix = ut::utf::valid_prefix(s);
+        assert(reference_valid(s.substr(0, prefix)));
+        assert(bValid == (prefix == s.size()));
+    }
+}
+
+void testTranscode()
+{
+    std::mt19937 rng(2);
+    for (int round = 0; round < 2000; ++round) {
+        std::u32string cps;
+        size_t         n = rng() % 100;
+        for (size_t i = 0; i < n; ++i) {
+            // long ASCII runs exercise the vector paths
+            cps += round % 3 ? random_code_point(rng) : char32_t('a' + rng() % 26);
+        }
+
+        auto utf8 = ut::utf::from_utf32(cps);
+        assert(utf8);
+        assert(ut::utf::to_utf32(*utf8) == cps);
+
+        auto utf16 = ut::utf::to_utf16(*utf8);
+        assert(utf16);
+        size_t pairs = 0;
+        for (char32_t cp : cps) {
+            pairs += cp >= 0x10000;
+        }
+        assert(utf16->size() == cps.size() + pairs);
+        assert(ut::utf::from_utf16(*utf16) == utf8);
+    }
+
+    assert(ut::utf::to_utf16("\xE4\xB8\xAD") == std::u16string(u"中"));
+    assert(ut::utf::to_utf16("\xF0\x9F\x98\x80") == std::u16string(u"\U0001F600"));
+    assert(!ut::utf::to_utf16("\xFF"));
+    assert(!ut::utf::from_utf16(std::u16string(1, char16_t(0xD800))));     // lone high surrogate
+    assert(!ut::utf::from_utf16(std::u16string(u"a") + char16_t(0xDC00))); // lone low surrogate
+    assert(!ut::utf::from_utf32(std::u32string(1, char32_t(0x110000))));
+}
+
+int main()
+{
+    testValidate();
+    testTranscode();
+
+    auto path = std::filesystem::temp_directory_path() / "ut_test_utf.txt";
+    std::ofstream(path, std::ios::binary) << "valid \xE2\x9C\x93";
+    assert(ut::file::read_all(path, true));
+    std::ofstream(path, std::ios::binary) << "broken \xE2\x9C";
+    assert(ut::file::read_all(path, false));
+    assert(!ut::file::read_all(path, true));
+    std::filesystem::remove(path);
+
+    std::cout << "utf ok" << std::endl;
+    return 0;
+}
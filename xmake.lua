@@ -6,6 +6,13 @@ do
     set_description("Enable debug logging for utility.cc StackDeleter")
 end
 
+option("utility_alloc_tracking")
+do
+    set_default(false)
+    set_showmenu(true)
+    set_description("Count heap allocations per UT_ALLOC_SCOPE, installs global operator new/delete hooks")
+end
+
 target("utility.cc")
 do
     set_kind("shared")
@@ -18,6 +25,13 @@ do
     if has_config("utility_debug") then
         add_defines("UTILITY_DEBUG_ENABLED")
     end
+    if has_config("utility_alloc_tracking") then
+        add_defines("UTILITY_ALLOC_TRACKING=1", { public = true })
+    end
+
+    if is_plat("linux") then
+        add_syslinks("pthread", { public = true }) -- job_system
+    end
 
     if is_plat("windows") then
         add_cxflags(
@@ -57,3 +71,21 @@ do -- grab all cpp file under test folder as a target
         end
     end
 end
+
+
+do -- grab all cpp file under bench folder as a target, always optimized
+    local bench_files = os.files(os.scriptdir() .. "/bench/*.cpp")
+    for _, file in ipairs(bench_files) do
+        local name = path.basename(file)
+        local target_name = "bench." .. name
+        target(target_name)
+        do
+            set_group("bench")
+            set_kind("binary")
+            set_optimize("fastest")
+            add_files(file)
+            add_deps("utility.cc")
+            target_end()
+        end
+    end
+end